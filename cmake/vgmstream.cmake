@@ -22,8 +22,8 @@ macro(setup_target TARGET)
 		set_target_properties(${TARGET} PROPERTIES LINK_SEARCH_END_STATIC 1)
 	endif()
 	if(NOT WIN32 AND LINK)
-		# Include libm on non-Windows systems
-		target_link_libraries(${TARGET} m)
+		# Include libm and pthreads on non-Windows systems
+		target_link_libraries(${TARGET} m pthread)
 	endif()
 
 	target_compile_definitions(${TARGET} PRIVATE VGM_LOG_OUTPUT)
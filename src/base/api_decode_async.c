@@ -0,0 +1,413 @@
+#include "api_internal.h"
+#include "sbuf.h"
+#include "mixing.h"
+#include "../util/threads.h"
+#if LIBVGMSTREAM_ENABLE
+
+/* ASYNC DECODE
+ * A worker thread decodes ahead into a ring buffer, so callers (like audio callbacks) can read samples without
+ * waiting for decoders or I/O. The ring has a single producer (worker) and a single consumer (reader), each one
+ * only moving its own position, so reads and writes don't need locks.
+ *
+ * The worker refills the ring once buffered samples drop below the watermark, then sleeps once it's full (reader
+ * only wakes it up when crossing the watermark). Seeks and stops are queued as commands under a mutex, as they
+ * are rare. Since the ring may still have samples decoded before a seek, each command increases a serial; once
+ * the worker handles them it publishes the serial plus the ring position where new samples start, and the reader
+ * skips to that position (returning nothing until then).
+ *
+ * Positions are free running ints (only differences are used, so wrapping around is fine) and the ring size is
+ * a power of 2, so index = position & (size - 1).
+ */
+
+#define ASYNC_MAX_COMMANDS 8
+#define ASYNC_BUF_SAMPLES_MAX 0x100000
+
+typedef enum {
+    ASYNC_CMD_SEEK,
+    ASYNC_CMD_RESET,
+    ASYNC_CMD_STOP,
+} async_cmd_type_t;
+
+typedef struct {
+    async_cmd_type_t type;
+    int64_t sample;
+} async_cmd_t;
+
+struct libvgmstream_priv_async_t {
+    libvgmstream_priv_t* priv;
+    vgm_thread_t* thread;
+    vgm_mutex_t* mutex;
+    vgm_cond_t* cond;               /* wakes up worker (new commands or reader crossed the watermark) */
+    vgm_mutex_t* decode_mutex;      /* held by worker while using the decoder */
+
+    /* commands (under mutex) */
+    async_cmd_t cmds[ASYNC_MAX_COMMANDS];
+    int cmds_count;
+    volatile int serial;            /* commands sent so far (changed by reader) */
+
+    /* ring buffer */
+    uint8_t* ring;
+    int ring_samples;
+    int frame_size;
+    int watermark;
+    volatile int write_pos;         /* moved by worker */
+    volatile int read_pos;          /* moved by reader */
+
+    /* worker state for reader */
+    volatile int idle;              /* waiting for commands or reader */
+    volatile int done_serial;       /* commands handled so far */
+    volatile int reset_pos;         /* ring position where samples after last handled command start */
+    volatile int eof_serial;        /* stream end was reached after this serial's commands */
+
+    /* reader state */
+    int read_serial;
+    int64_t position;
+    int64_t play_samples;
+    bool play_forever;
+    sfmt_t sfmt;
+};
+
+
+static inline int add_pos(int pos, int samples) {
+    return (int)((unsigned)pos + (unsigned)samples);
+}
+
+static inline int get_buffered(libvgmstream_priv_async_t* async) {
+    return (int)((unsigned)vgm_atomic_get(&async->write_pos) - (unsigned)vgm_atomic_get(&async->read_pos));
+}
+
+static void write_ring(libvgmstream_priv_async_t* async, const uint8_t* src, int samples) {
+    int pos = async->write_pos;
+    int index = pos & (async->ring_samples - 1);
+    int frame_size = async->frame_size;
+
+    int samples_end = async->ring_samples - index;
+    if (samples_end > samples)
+        samples_end = samples;
+
+    memcpy(async->ring + index * frame_size, src, samples_end * frame_size);
+    memcpy(async->ring, src + samples_end * frame_size, (samples - samples_end) * frame_size);
+
+    vgm_atomic_set(&async->write_pos, add_pos(pos, samples));
+}
+
+static void read_ring(libvgmstream_priv_async_t* async, void* buf, int buf_samples, int samples) {
+    int pos = async->read_pos;
+    int frame_size = async->frame_size;
+    int done = 0;
+
+    while (done < samples) {
+        int index = add_pos(pos, done) & (async->ring_samples - 1);
+        int to_do = async->ring_samples - index;
+        if (to_do > samples - done)
+            to_do = samples - done;
+
+        uint8_t* src = async->ring + index * frame_size;
+        if (async->priv->planar) {
+            void* dst[VGMSTREAM_MAX_CHANNELS];
+            int channels = async->priv->fmt.channels;
+            for (int ch = 0; ch < channels; ch++) {
+                dst[ch] = ((uint8_t*)buf) + ch * buf_samples * async->priv->fmt.sample_size;
+            }
+
+            sbuf_t sbuf = {0};
+            sbuf_init(&sbuf, async->sfmt, src, to_do, channels);
+            sbuf.filled = to_do;
+            sbuf_copy_to_planar(dst, done, &sbuf);
+        }
+        else {
+            memcpy(((uint8_t*)buf) + done * frame_size, src, to_do * frame_size);
+        }
+
+        done += to_do;
+    }
+
+    vgm_atomic_set(&async->read_pos, add_pos(pos, samples));
+}
+
+/* called with mutex locked */
+static bool has_work(libvgmstream_priv_async_t* async, bool* p_filling, bool eof) {
+    if (async->cmds_count > 0)
+        return true;
+    if (eof)
+        return false;
+
+    int buffered = get_buffered(async);
+    if (buffered < async->watermark)
+        *p_filling = true;
+    if (async->ring_samples - buffered < async->priv->block_samples)
+        *p_filling = false;
+    return *p_filling;
+}
+
+static void async_worker(void* arg) {
+    libvgmstream_priv_async_t* async = arg;
+    libvgmstream_priv_t* priv = async->priv;
+    async_cmd_t cmds[ASYNC_MAX_COMMANDS];
+    int serial = 0;
+    bool filling = true;
+    bool eof = false;
+
+    while (true) {
+        int cmds_count;
+
+        vgm_mutex_lock(async->mutex);
+        while (!has_work(async, &filling, eof)) {
+            /* reader may have moved before seeing the flag, so recheck before waiting */
+            vgm_atomic_set(&async->idle, 1);
+            if (has_work(async, &filling, eof)) {
+                vgm_atomic_set(&async->idle, 0);
+                break;
+            }
+
+            vgm_cond_wait(async->cond, async->mutex);
+            vgm_atomic_set(&async->idle, 0);
+        }
+
+        cmds_count = async->cmds_count;
+        memcpy(cmds, async->cmds, cmds_count * sizeof(async_cmd_t));
+        async->cmds_count = 0;
+        if (cmds_count > 0)
+            serial = async->serial;
+        vgm_mutex_unlock(async->mutex);
+
+
+        vgm_mutex_lock(async->decode_mutex);
+
+        if (cmds_count > 0) {
+            for (int i = 0; i < cmds_count; i++) {
+                switch(cmds[i].type) {
+                    case ASYNC_CMD_SEEK:
+                        api_seek(priv, cmds[i].sample);
+                        eof = false;
+                        break;
+                    case ASYNC_CMD_RESET:
+                        reset_vgmstream(priv->vgmstream);
+                        api_reset_decoder(priv);
+                        eof = false;
+                        break;
+                    case ASYNC_CMD_STOP:
+                        vgm_mutex_unlock(async->decode_mutex);
+                        return;
+                    default:
+                        break;
+                }
+            }
+
+            /* samples already in the ring are from before commands */
+            vgm_atomic_set(&async->reset_pos, async->write_pos);
+            vgm_atomic_set(&async->done_serial, serial);
+            filling = true;
+        }
+        else {
+            int err = api_render(priv, false);
+            if (err < 0 || priv->buf.samples <= 0) {
+                eof = true;
+                vgm_atomic_set(&async->eof_serial, serial);
+            }
+            else {
+                write_ring(async, priv->buf.data, priv->buf.samples);
+            }
+        }
+
+        vgm_mutex_unlock(async->decode_mutex);
+    }
+}
+
+static void push_command(libvgmstream_priv_async_t* async, async_cmd_type_t type, int64_t sample) {
+    vgm_mutex_lock(async->mutex);
+
+    /* only latest seek matters if too many are queued */
+    if (async->cmds_count >= ASYNC_MAX_COMMANDS)
+        async->cmds_count--;
+
+    async_cmd_t* cmd = &async->cmds[async->cmds_count];
+    cmd->type = type;
+    cmd->sample = sample;
+    async->cmds_count++;
+
+    vgm_atomic_set(&async->serial, async->serial + 1);
+    vgm_cond_signal(async->cond);
+
+    vgm_mutex_unlock(async->mutex);
+}
+
+static void free_async(libvgmstream_priv_async_t* async) {
+    if (!async)
+        return;
+
+    vgm_mutex_free(async->mutex);
+    vgm_mutex_free(async->decode_mutex);
+    vgm_cond_free(async->cond);
+    free(async->ring);
+    free(async);
+}
+
+void api_async_start(libvgmstream_priv_t* priv) {
+    libvgmstream_priv_async_t* async = NULL;
+
+    int samples = priv->cfg.async_samples;
+    if (samples <= 0 || !priv->vgmstream || priv->async)
+        return;
+
+    /* without threads (or atomics for the ring) _read_async decodes directly */
+    if (!vgm_threads_available() || !vgm_atomics_available())
+        return;
+
+    async = calloc(1, sizeof(libvgmstream_priv_async_t));
+    if (!async) goto fail;
+
+    async->priv = priv;
+
+    /* worker writes whole blocks */
+    if (samples > ASYNC_BUF_SAMPLES_MAX)
+        samples = ASYNC_BUF_SAMPLES_MAX;
+    if (samples < priv->block_samples * 2)
+        samples = priv->block_samples * 2;
+    async->ring_samples = 1;
+    while (async->ring_samples < samples) {
+        async->ring_samples <<= 1;
+    }
+
+    async->watermark = priv->cfg.async_watermark;
+    if (async->watermark <= 0)
+        async->watermark = async->ring_samples / 2;
+    if (async->watermark > async->ring_samples - priv->block_samples)
+        async->watermark = async->ring_samples - priv->block_samples;
+
+    async->frame_size = priv->fmt.sample_size * priv->fmt.channels;
+    async->ring = malloc(async->ring_samples * async->frame_size);
+    if (!async->ring) goto fail;
+
+    async->mutex = vgm_mutex_init();
+    async->decode_mutex = vgm_mutex_init();
+    async->cond = vgm_cond_init();
+    if (!async->mutex || !async->decode_mutex || !async->cond) goto fail;
+
+    async->eof_serial = -1;
+    async->play_samples = priv->pos.play_samples;
+    async->play_forever = priv->pos.play_forever;
+    async->position = priv->pos.current;
+    async->sfmt = mixing_get_output_sample_type(priv->vgmstream);
+
+    async->thread = vgm_thread_init(async_worker, async);
+    if (!async->thread) goto fail;
+
+    priv->async = async;
+    return;
+fail:
+    free_async(async);
+}
+
+void api_async_stop(libvgmstream_priv_t* priv) {
+    libvgmstream_priv_async_t* async = priv->async;
+    if (!async)
+        return;
+
+    push_command(async, ASYNC_CMD_STOP, 0);
+    vgm_thread_join(async->thread);
+
+    priv->async = NULL;
+    free_async(async);
+}
+
+void api_async_seek(libvgmstream_priv_t* priv, int64_t sample) {
+    libvgmstream_priv_async_t* async = priv->async;
+
+    /* same clamping as the decoder, so position is right before the worker seeks */
+    if (sample < 0)
+        sample = 0;
+    if (!async->play_forever && sample > async->play_samples)
+        sample = async->play_samples;
+
+    async->position = sample;
+    priv->dec.done = false;
+
+    push_command(async, ASYNC_CMD_SEEK, sample);
+}
+
+/* same as sync reset except for format info (still needed to read) */
+void api_async_reset(libvgmstream_priv_t* priv) {
+    libvgmstream_priv_async_t* async = priv->async;
+
+    async->position = 0;
+    memset(&priv->dec, 0, sizeof(libvgmstream_decoder_t));
+
+    push_command(async, ASYNC_CMD_RESET, 0);
+}
+
+int64_t api_async_get_position(libvgmstream_priv_t* priv) {
+    return priv->async->position;
+}
+
+void api_async_lock(libvgmstream_priv_t* priv) {
+    if (!priv->async)
+        return;
+    vgm_mutex_lock(priv->async->decode_mutex);
+}
+
+void api_async_unlock(libvgmstream_priv_t* priv) {
+    if (!priv->async)
+        return;
+    vgm_mutex_unlock(priv->async->decode_mutex);
+}
+
+
+LIBVGMSTREAM_API int libvgmstream_read_async(libvgmstream_t* lib, void* buf, int buf_samples) {
+    if (!lib || !lib->priv || !buf || buf_samples <= 0)
+        return LIBVGMSTREAM_ERROR_GENERIC;
+
+    libvgmstream_priv_t* priv = lib->priv;
+    if (!priv->vgmstream)
+        return LIBVGMSTREAM_ERROR_GENERIC;
+
+    libvgmstream_priv_async_t* async = priv->async;
+    if (!async) {
+        /* not enabled or not possible: decode here */
+        if (priv->decode_done) {
+            priv->dec.buf = buf;
+            priv->dec.buf_bytes = 0;
+            priv->dec.buf_samples = 0;
+            priv->dec.done = true;
+            return 0;
+        }
+        return libvgmstream_render_into(lib, buf, buf_samples);
+    }
+
+    int done = 0;
+    bool finished = false;
+    int serial = async->serial;
+    if (vgm_atomic_get(&async->done_serial) == serial) {
+        if (async->read_serial != serial) {
+            vgm_atomic_set(&async->read_pos, vgm_atomic_get(&async->reset_pos));
+            async->read_serial = serial;
+        }
+
+        /* end flag is set after writing last samples, so must be read first */
+        bool eof = vgm_atomic_get(&async->eof_serial) == serial;
+        int buffered = get_buffered(async);
+
+        done = buffered;
+        if (done > buf_samples)
+            done = buf_samples;
+        read_ring(async, buf, buf_samples, done);
+        async->position += done;
+        buffered -= done;
+
+        finished = eof && buffered == 0;
+        if (!eof && buffered < async->watermark && vgm_atomic_get(&async->idle)) {
+            vgm_mutex_lock(async->mutex);
+            vgm_cond_signal(async->cond);
+            vgm_mutex_unlock(async->mutex);
+        }
+    }
+
+    priv->dec.buf = buf;
+    priv->dec.buf_bytes = done * async->frame_size;
+    priv->dec.buf_samples = done;
+    priv->dec.done = finished;
+
+    return done;
+}
+
+#endif
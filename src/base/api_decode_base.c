@@ -1,8 +1,11 @@
 #include "api_internal.h"
 #include "mixing.h"
+#include "decode.h"
+#include "../util/threads.h"
 #if LIBVGMSTREAM_ENABLE
 
-#define INTERNAL_BUF_SAMPLES  1024
+/* open instances, to release shared codec caches once the last one is gone */
+static int g_lib_instances;
 
 
 LIBVGMSTREAM_API uint32_t libvgmstream_get_version(void) {
@@ -22,6 +25,10 @@ LIBVGMSTREAM_API libvgmstream_t* libvgmstream_init(void) {
 
     priv = lib->priv;
 
+    vgm_global_lock();
+    g_lib_instances++;
+    vgm_global_unlock();
+
     //TODO only setup on decode? (but may less error prone if always set)
     lib->format = &priv->fmt;
     lib->decoder = &priv->dec;
@@ -40,32 +47,56 @@ LIBVGMSTREAM_API void libvgmstream_free(libvgmstream_t* lib) {
         return;
 
     libvgmstream_priv_t* priv = lib->priv;
+    bool last = false;
     if (priv) {
+        api_async_stop(priv);
         close_vgmstream(priv->vgmstream);
+        close_streamfile(priv->sf);
         free(priv->buf.data);
+        free(priv->buf.planar_data);
+        resampler_free(priv->res.rs);
+        free(priv->res.data);
+
+        vgm_global_lock();
+        g_lib_instances--;
+        last = (g_lib_instances == 0);
+        vgm_global_unlock();
     }
 
     free(priv);
     free(lib);
+
+    /* caches take the global lock too */
+    if (last)
+        decode_free_caches();
 }
 
 
-LIBVGMSTREAM_API void libvgmstream_setup(libvgmstream_t* lib, libvgmstream_config_t* cfg) {
+LIBVGMSTREAM_API void libvgmstream_setup_size(libvgmstream_t* lib, libvgmstream_config_t* cfg, size_t cfg_size) {
     if (!lib || !lib->priv)
         return;
 
     libvgmstream_priv_t* priv = lib->priv;
+    memset(&priv->cfg , 0, sizeof(libvgmstream_config_t));
     if (!cfg) {
-        memset(&priv->cfg , 0, sizeof(libvgmstream_config_t));
         priv->cfg.loop_count = 1; //TODO: loop 0 means no loop (improve detection)
     }
     else {
-        priv->cfg = *cfg;
+        // callers built with an older header pass a smaller config (newer fields are appended and stay 0)
+        if (cfg_size > sizeof(libvgmstream_config_t))
+            cfg_size = sizeof(libvgmstream_config_t);
+        memcpy(&priv->cfg, cfg, cfg_size);
     }
 
     //TODO validate, etc
 }
 
+// 1.0.0 symbol for callers built before libvgmstream_setup became a macro (their config ends at force_float)
+#undef libvgmstream_setup
+LIBVGMSTREAM_API void libvgmstream_setup(libvgmstream_t* lib, libvgmstream_config_t* cfg) {
+    libvgmstream_setup_size(lib, cfg, offsetof(libvgmstream_config_t, decode_threads));
+}
+
 
 void libvgmstream_priv_reset(libvgmstream_priv_t* priv, bool reset_buf) {
     //memset(&priv->cfg, 0, sizeof(libvgmstream_config_t)); //config is always valid
@@ -75,9 +106,27 @@ void libvgmstream_priv_reset(libvgmstream_priv_t* priv, bool reset_buf) {
 
     if (reset_buf) {
         free(priv->buf.data);
+        free(priv->buf.planar_data);
         memset(&priv->buf, 0, sizeof(libvgmstream_priv_buf_t));
+
+        resampler_free(priv->res.rs);
+        free(priv->res.data);
+        memset(&priv->res, 0, sizeof(libvgmstream_priv_resample_t));
     }
 
+    api_reset_decoder(priv);
+}
+
+// decoder state back to start (async workers call this too, so external info isn't touched)
+void api_reset_decoder(libvgmstream_priv_t* priv) {
+    if (priv->res.rs) {
+        resampler_reset(priv->res.rs, 0, 0);
+    }
+    priv->res.samples = 0;
+    priv->res.consumed = 0;
+    priv->res.input_current = 0;
+    priv->res.output_current = 0;
+
     priv->pos.current = 0;
     priv->decode_done = false;
 }
@@ -93,6 +142,15 @@ libvgmstream_sample_t api_get_output_sample_type(libvgmstream_priv_t* priv) {
     }
 }
 
+int api_get_block_samples(libvgmstream_priv_t* priv) {
+    int block_samples = priv->cfg.block_samples;
+    if (block_samples <= 0)
+        return INTERNAL_BUF_SAMPLES;
+    if (block_samples > INTERNAL_BUF_SAMPLES_MAX)
+        return INTERNAL_BUF_SAMPLES_MAX;
+    return block_samples;
+}
+
 int api_get_sample_size(libvgmstream_sample_t sample_type) {
     switch(sample_type) {
         case LIBVGMSTREAM_SAMPLE_PCM24:
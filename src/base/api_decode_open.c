@@ -1,6 +1,9 @@
 #include "api_internal.h"
 #include "sbuf.h"
 #include "mixing.h"
+#include "seek_index.h"
+#include "../vgmstream_init.h"
+#include "../util/threads.h"
 #if LIBVGMSTREAM_ENABLE
 
 
@@ -10,9 +13,24 @@ static void load_vgmstream(libvgmstream_priv_t* priv, libvgmstream_options_t* op
         return;
 
     //TODO: handle internal format_id
-    
+
+    /* decode threads also allow slow parsing steps in parallel (results are the same) */
+    int threads = priv->cfg.decode_threads;
+    if (threads < 0)
+        threads = vgm_threads_get_cpus();
+
     sf_api->stream_index = opt->subsong_index;
+    sf_api->parse_threads = threads;
     priv->vgmstream = init_vgmstream_from_STREAMFILE(sf_api);
+
+    /* clones of complex formats need to parse the file again (opt-in, as it keeps a file handle per song) */
+    if (priv->vgmstream && priv->cfg.clone_keep_file && !vgmstream_is_clonable(priv->vgmstream)) {
+        priv->sf = reopen_streamfile(sf_api, 0);
+        if (priv->sf) {
+            priv->sf->stream_index = opt->subsong_index;
+            priv->sf->parse_threads = threads;
+        }
+    }
     close_streamfile(sf_api);
 }
 
@@ -40,13 +58,40 @@ static void apply_config(libvgmstream_priv_t* priv) {
     vgmstream_apply_config(priv->vgmstream, &vcfg);
 }
 
-static void prepare_mixing(libvgmstream_priv_t* priv, libvgmstream_options_t* opt) {
+static void apply_decode_config(libvgmstream_priv_t* priv) {
+    libvgmstream_config_t* cfg = &priv->cfg;
+
+    if (cfg->decode_threads) {
+        int modes = cfg->decode_threads_mode ? cfg->decode_threads_mode : VGM_THREADS_ALL;
+        vgmstream_set_decode_threads(priv->vgmstream, cfg->decode_threads, modes); /* decodes normally on failure */
+    }
+
+    if (cfg->seek_index) {
+        vgmstream_set_seek_index(priv->vgmstream, true);
+    }
+}
+
+static void enable_mixing(libvgmstream_priv_t* priv) {
+    priv->block_samples = api_get_block_samples(priv);
+    vgmstream_mixing_enable(priv->vgmstream, priv->block_samples, NULL /*&input_channels*/, NULL /*&output_channels*/);
+
+    /* render writes input samples first then mixes them in place, so external bufs sized for output may be too small */
+    int input_channels = 0, output_channels = 0;
+    vgmstream_mixing_enable(priv->vgmstream, 0, &input_channels, &output_channels); //query
+
+    int input_sample_size = sfmt_get_sample_size(mixing_get_input_sample_type(priv->vgmstream));
+    int output_sample_size = sfmt_get_sample_size(mixing_get_output_sample_type(priv->vgmstream));
+    priv->planar = priv->cfg.planar_output;
+    priv->direct_render = input_channels * input_sample_size <= output_channels * output_sample_size && !priv->planar;
+}
+
+static void prepare_mixing(libvgmstream_priv_t* priv) {
     /* enable after config but before outbuf */
     if (priv->cfg.auto_downmix_channels) {
         vgmstream_mixing_autodownmix(priv->vgmstream, priv->cfg.auto_downmix_channels);
     }
-    else if (opt && opt->stereo_track >= 1) {
-        vgmstream_mixing_stereo_only(priv->vgmstream, opt->stereo_track - 1);
+    else if (priv->stereo_track >= 1) {
+        vgmstream_mixing_stereo_only(priv->vgmstream, priv->stereo_track - 1);
     }
 
     if (priv->cfg.force_pcm16) {
@@ -56,7 +101,43 @@ static void prepare_mixing(libvgmstream_priv_t* priv, libvgmstream_options_t* op
         mixing_macro_output_sample_format(priv->vgmstream, SFMT_FLT);
     }
 
-    vgmstream_mixing_enable(priv->vgmstream, INTERNAL_BUF_SAMPLES, NULL /*&input_channels*/, NULL /*&output_channels*/);
+    enable_mixing(priv);
+}
+
+static void prepare_resampler(libvgmstream_priv_t* priv) {
+    libvgmstream_priv_resample_t* res = &priv->res;
+    VGMSTREAM* v = priv->vgmstream;
+
+    if (priv->cfg.resample_rate <= 0 || priv->cfg.resample_rate == v->sample_rate)
+        return;
+
+    int input_channels = 0, output_channels = 0;
+    vgmstream_mixing_enable(v, 0, &input_channels, &output_channels); //query
+
+    int max_channels = input_channels > output_channels ? input_channels : output_channels;
+    int input_sample_size = sfmt_get_sample_size(mixing_get_input_sample_type(v));
+    int output_sample_size = sfmt_get_sample_size(mixing_get_output_sample_type(v));
+    int max_sample_size = input_sample_size > output_sample_size ? input_sample_size : output_sample_size;
+
+    int quality = priv->cfg.resample_quality;
+    switch(quality) {
+        case LIBVGMSTREAM_RESAMPLE_FAST:    quality = RESAMPLER_QUALITY_FAST; break;
+        case LIBVGMSTREAM_RESAMPLE_BEST:    quality = RESAMPLER_QUALITY_BEST; break;
+        default:                            quality = RESAMPLER_QUALITY_MEDIUM; break;
+    }
+
+    /* plays at file's rate on failure */
+    res->data = malloc(priv->block_samples * max_channels * max_sample_size);
+    if (!res->data) goto fail;
+    res->rs = resampler_init(output_channels, v->sample_rate, priv->cfg.resample_rate, quality);
+    if (!res->rs) goto fail;
+
+    /* render writes resampler's output only, so external bufs are always fine */
+    priv->direct_render = !priv->planar;
+    return;
+fail:
+    free(res->data);
+    res->data = NULL;
 }
 
 static void update_position(libvgmstream_priv_t* priv) {
@@ -66,6 +147,11 @@ static void update_position(libvgmstream_priv_t* priv) {
     pos->play_forever = vgmstream_get_play_forever(v);
     pos->play_samples = vgmstream_get_samples(v);
     pos->current = 0;
+
+    if (priv->res.rs) {
+        priv->res.input_play_samples = pos->play_samples;
+        pos->play_samples = resampler_get_output_samples(priv->res.rs, pos->play_samples);
+    }
 }
 
 static void update_format_info(libvgmstream_priv_t* priv) {
@@ -82,8 +168,10 @@ static void update_format_info(libvgmstream_priv_t* priv) {
 
     fmt->sample_type = api_get_output_sample_type(priv);
     fmt->sample_size = api_get_sample_size(fmt->sample_type);
+    fmt->planar = priv->planar;
 
-    fmt->sample_rate = v->sample_rate;
+    fmt->sample_rate = priv->res.rs ? priv->cfg.resample_rate : v->sample_rate;
+    fmt->input_sample_rate = v->sample_rate;
 
     fmt->stream_samples = v->num_samples;
     fmt->loop_start = v->loop_start_sample;
@@ -117,15 +205,20 @@ LIBVGMSTREAM_API int libvgmstream_open_song(libvgmstream_t* lib, libvgmstream_op
 
     libvgmstream_priv_t* priv = lib->priv;
 
+    priv->stereo_track = opt->stereo_track;
+
     load_vgmstream(priv, opt);
     if (!priv->vgmstream)
         return LIBVGMSTREAM_ERROR_GENERIC;
     apply_config(priv);
-    prepare_mixing(priv, opt);
+    apply_decode_config(priv);
+    prepare_mixing(priv);
+    prepare_resampler(priv);
     update_position(priv);
 
     update_format_info(priv);
 
+    api_async_start(priv);
 
     return LIBVGMSTREAM_OK;
 }
@@ -137,10 +230,75 @@ LIBVGMSTREAM_API void libvgmstream_close_song(libvgmstream_t* lib) {
 
     libvgmstream_priv_t* priv = lib->priv;
 
+    api_async_stop(priv);
+
     close_vgmstream(priv->vgmstream);
     priv->vgmstream = NULL;
+    close_streamfile(priv->sf);
+    priv->sf = NULL;
 
     libvgmstream_priv_reset(priv, true);
 }
 
+
+LIBVGMSTREAM_API libvgmstream_t* libvgmstream_clone(libvgmstream_t* lib) {
+    libvgmstream_t* new_lib = NULL;
+
+    if (!lib || !lib->priv)
+        return NULL;
+
+    libvgmstream_priv_t* priv = lib->priv;
+
+    new_lib = libvgmstream_init();
+    if (!new_lib)
+        return NULL;
+
+    libvgmstream_priv_t* new_priv = new_lib->priv;
+    new_priv->cfg = priv->cfg;
+    new_priv->stereo_track = priv->stereo_track;
+
+    if (!priv->vgmstream)
+        return new_lib;
+
+    /* pauses lib's async worker, if any */
+    api_async_lock(priv);
+
+    /* copy parsed data and play config/mixing as-is if possible, or reopen the same format otherwise */
+    new_priv->vgmstream = clone_vgmstream(priv->vgmstream);
+    if (new_priv->vgmstream) {
+        apply_decode_config(new_priv);
+        seek_index_copy(new_priv->vgmstream, priv->vgmstream);
+        enable_mixing(new_priv);
+    }
+    else {
+        if (!priv->sf) goto fail;
+
+        new_priv->vgmstream = init_vgmstream_from_format_id(priv->sf, priv->vgmstream->format_id);
+        if (!new_priv->vgmstream) goto fail;
+
+        new_priv->sf = reopen_streamfile(priv->sf, 0);
+        if (!new_priv->sf) goto fail;
+        new_priv->sf->stream_index = priv->sf->stream_index;
+        new_priv->sf->parse_threads = priv->sf->parse_threads;
+
+        apply_config(new_priv);
+        apply_decode_config(new_priv);
+        prepare_mixing(new_priv);
+    }
+    prepare_resampler(new_priv);
+    update_position(new_priv);
+
+    update_format_info(new_priv);
+
+    api_async_unlock(priv);
+
+    api_async_start(new_priv);
+
+    return new_lib;
+fail:
+    api_async_unlock(priv);
+    libvgmstream_free(new_lib);
+    return NULL;
+}
+
 #endif
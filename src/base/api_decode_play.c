@@ -30,7 +30,7 @@ static bool reset_buf(libvgmstream_priv_t* priv) {
     if (min_sample_size < output_sample_size)
         min_sample_size = output_sample_size;
 
-    priv->buf.max_samples = INTERNAL_BUF_SAMPLES;
+    priv->buf.max_samples = priv->block_samples;
     priv->buf.sample_size = output_sample_size;
     priv->buf.channels = output_channels;
 
@@ -38,6 +38,11 @@ static bool reset_buf(libvgmstream_priv_t* priv) {
     priv->buf.data = malloc(max_bytes);
     if (!priv->buf.data) return false;
 
+    if (priv->planar) {
+        priv->buf.planar_data = malloc(priv->buf.max_samples * output_sample_size * output_channels);
+        if (!priv->buf.planar_data) return false;
+    }
+
     priv->buf.initialized = true;
     return true;
 }
@@ -54,21 +59,85 @@ static void update_buf(libvgmstream_priv_t* priv, int samples_done) {
 }
 
 
+// renders final output samples into buf, resampling if needed
+static int render_internal(libvgmstream_priv_t* priv, void* buf, int buf_samples) {
+    libvgmstream_priv_resample_t* res = &priv->res;
+    if (!res->rs)
+        return render_vgmstream(buf, buf_samples, priv->vgmstream);
+
+    sfmt_t sfmt = mixing_get_output_sample_type(priv->vgmstream);
+    int channels = priv->fmt.channels;
+    int frame_size = priv->fmt.sample_size * channels;
+
+    sbuf_t sbuf = {0};
+    sbuf_init(&sbuf, sfmt, buf, buf_samples, channels);
+
+    while (true) {
+        resampler_render(res->rs, &sbuf);
+        if (sbuf.filled >= buf_samples)
+            break;
+
+        // more input needed
+        if (res->consumed >= res->samples) {
+            int to_get = priv->block_samples;
+            if (!priv->pos.play_forever && to_get + res->input_current > res->input_play_samples)
+                to_get = res->input_play_samples - res->input_current;
+
+            res->samples = 0;
+            res->consumed = 0;
+            if (to_get > 0)
+                res->samples = render_vgmstream(res->data, to_get, priv->vgmstream);
+            res->input_current += res->samples;
+
+            // flush filter after last sample (caller stops at play_samples)
+            if (res->samples <= 0) {
+                resampler_feed_silence(res->rs);
+                continue;
+            }
+        }
+
+        sbuf_t sbuf_in = {0};
+        sbuf_init(&sbuf_in, sfmt, ((uint8_t*)res->data) + res->consumed * frame_size, res->samples - res->consumed, channels);
+        sbuf_in.filled = res->samples - res->consumed;
+
+        res->consumed += resampler_feed(res->rs, &sbuf_in);
+    }
+
+    res->output_current += sbuf.filled;
+    return sbuf.filled;
+}
+
+// copies internal buf samples into planar buf (where each channel is 'buf_samples' long)
+static void deinterleave_buf(libvgmstream_priv_t* priv, void* buf, int buf_samples, int buf_pos, int src_pos, int samples) {
+    void* dst[VGMSTREAM_MAX_CHANNELS];
+    int channels = priv->buf.channels;
+    int sample_size = priv->buf.sample_size;
+    int frame_size = sample_size * channels;
+
+    for (int ch = 0; ch < channels; ch++) {
+        dst[ch] = ((uint8_t*)buf) + ch * buf_samples * sample_size;
+    }
+
+    sbuf_t sbuf = {0};
+    sbuf_init(&sbuf, mixing_get_output_sample_type(priv->vgmstream), ((uint8_t*)priv->buf.data) + src_pos * frame_size, samples, channels);
+    sbuf.filled = samples;
+
+    sbuf_copy_to_planar(dst, buf_pos, &sbuf);
+}
+
 // update decoder info based on last render, though at the moment it's all fixed
 static void update_decoder_info(libvgmstream_priv_t* priv, int samples_done) {
 
     // output copy
-    priv->dec.buf = priv->buf.data;
+    priv->dec.buf = priv->planar ? priv->buf.planar_data : priv->buf.data;
     priv->dec.buf_bytes = priv->buf.bytes;
     priv->dec.buf_samples = priv->buf.samples;
     priv->dec.done = priv->decode_done;
 }
 
-LIBVGMSTREAM_API int libvgmstream_render(libvgmstream_t* lib) {
-    if (!lib || !lib->priv)
-        return LIBVGMSTREAM_ERROR_GENERIC;
-
-    libvgmstream_priv_t* priv = lib->priv;
+// renders next block into internal buf (doesn't touch external decoder info, as async workers call this too)
+// - planar output is only deinterleaved when requested, as callers that copy the interleaved buf do it themselves
+int api_render(libvgmstream_priv_t* priv, bool deinterleave) {
     if (priv->decode_done)
         return LIBVGMSTREAM_ERROR_GENERIC;
 
@@ -79,13 +148,50 @@ LIBVGMSTREAM_API int libvgmstream_render(libvgmstream_t* lib) {
     if (!priv->pos.play_forever && to_get + priv->pos.current > priv->pos.play_samples)
         to_get = priv->pos.play_samples - priv->pos.current;
 
-    int decoded = render_vgmstream(priv->buf.data, to_get, priv->vgmstream);
+    int decoded = render_internal(priv, priv->buf.data, to_get);
     update_buf(priv, decoded);
-    update_decoder_info(priv, decoded);
+    if (priv->planar && deinterleave) {
+        deinterleave_buf(priv, priv->buf.planar_data, decoded, 0, 0, decoded);
+    }
 
     return LIBVGMSTREAM_OK;
 }
 
+LIBVGMSTREAM_API int libvgmstream_render(libvgmstream_t* lib) {
+    if (!lib || !lib->priv)
+        return LIBVGMSTREAM_ERROR_GENERIC;
+
+    libvgmstream_priv_t* priv = lib->priv;
+    if (priv->async) // decoded by the worker (see _read_async)
+        return LIBVGMSTREAM_ERROR_GENERIC;
+
+    int err = api_render(priv, true);
+    if (err < 0) return err;
+    update_decoder_info(priv, priv->buf.samples);
+
+    return LIBVGMSTREAM_OK;
+}
+
+
+// copies samples left in internal buf from last render into buf's position
+static int copy_buf(libvgmstream_priv_t* priv, void* buf, int buf_samples, int buf_pos) {
+    int copy_samples = priv->buf.samples - priv->buf.consumed;
+    if (copy_samples > buf_samples - buf_pos)
+        copy_samples = buf_samples - buf_pos;
+    if (copy_samples <= 0)
+        return 0;
+
+    if (priv->planar) {
+        deinterleave_buf(priv, buf, buf_samples, buf_pos, priv->buf.consumed, copy_samples);
+    }
+    else {
+        int frame_size = priv->buf.sample_size * priv->buf.channels;
+        memcpy(((uint8_t*)buf) + buf_pos * frame_size, ((uint8_t*)priv->buf.data) + priv->buf.consumed * frame_size, copy_samples * frame_size);
+    }
+    priv->buf.consumed += copy_samples;
+
+    return copy_samples;
+}
 
 /* _play decodes a single frame, while this copies partially that frame until frame is over */
 LIBVGMSTREAM_API int libvgmstream_fill(libvgmstream_t* lib, void* buf, int buf_samples) {
@@ -93,24 +199,76 @@ LIBVGMSTREAM_API int libvgmstream_fill(libvgmstream_t* lib, void* buf, int buf_s
         return LIBVGMSTREAM_ERROR_GENERIC;
 
     libvgmstream_priv_t* priv = lib->priv;
-    if (priv->decode_done)
+    if (priv->decode_done || priv->async)
         return LIBVGMSTREAM_ERROR_GENERIC;
 
     if (priv->buf.consumed >= priv->buf.samples) {
+        /* no need to go through internal buf */
+        if (priv->direct_render)
+            return libvgmstream_render_into(lib, buf, buf_samples);
+
         int err = libvgmstream_render(lib);
         if (err < 0) return err;
     }
 
-    int copy_samples = priv->buf.samples;
-    if (copy_samples > buf_samples)
-        copy_samples = buf_samples;
-    int copy_bytes = priv->buf.sample_size * priv->buf.channels * copy_samples;
-    int skip_bytes = priv->buf.sample_size * priv->buf.channels * priv->buf.consumed;
+    return copy_buf(priv, buf, buf_samples, 0);
+}
 
-    memcpy(buf, ((uint8_t*)priv->buf.data) + skip_bytes, copy_bytes);
-    priv->buf.consumed += copy_samples;
 
-    return copy_samples;
+LIBVGMSTREAM_API int libvgmstream_render_into(libvgmstream_t* lib, void* buf, int buf_samples) {
+    if (!lib || !lib->priv || !buf || buf_samples <= 0)
+        return LIBVGMSTREAM_ERROR_GENERIC;
+
+    libvgmstream_priv_t* priv = lib->priv;
+    if (!priv->vgmstream || priv->decode_done || priv->async)
+        return LIBVGMSTREAM_ERROR_GENERIC;
+
+    int frame_size = priv->fmt.sample_size * priv->fmt.channels;
+    uint8_t* dst = buf;
+
+    int done = copy_buf(priv, dst, buf_samples, 0);
+
+    if (priv->direct_render) {
+        /* mixing bufs are only as big as a block */
+        while (done < buf_samples) {
+            int to_get = buf_samples - done;
+            if (to_get > priv->block_samples)
+                to_get = priv->block_samples;
+            if (!priv->pos.play_forever && to_get + priv->pos.current > priv->pos.play_samples)
+                to_get = priv->pos.play_samples - priv->pos.current;
+            if (to_get <= 0)
+                break;
+
+            int decoded = render_internal(priv, dst + done * frame_size, to_get);
+            if (!priv->pos.play_forever)
+                priv->pos.current += decoded;
+            done += decoded;
+
+            if (decoded < to_get)
+                break;
+        }
+
+        /* same as _render, flagged when called again after the end */
+        if (done == 0 && !priv->pos.play_forever)
+            priv->decode_done = (priv->pos.current >= priv->pos.play_samples);
+    }
+    else {
+        while (done < buf_samples) {
+            int err = api_render(priv, false);
+            if (err < 0) return err;
+            if (priv->buf.samples == 0)
+                break;
+
+            done += copy_buf(priv, buf, buf_samples, done);
+        }
+    }
+
+    priv->dec.buf = buf;
+    priv->dec.buf_bytes = done * frame_size;
+    priv->dec.buf_samples = done;
+    priv->dec.done = priv->decode_done;
+
+    return done;
 }
 
 
@@ -122,10 +280,51 @@ LIBVGMSTREAM_API int64_t libvgmstream_get_play_position(libvgmstream_t* lib) {
     if (!priv->vgmstream)
         return LIBVGMSTREAM_ERROR_GENERIC;
 
+    if (priv->async)
+        return api_async_get_position(priv);
+    if (priv->res.rs)
+        return priv->res.output_current;
     return priv->vgmstream->pstate.play_position;
 }
 
 
+void api_seek(libvgmstream_priv_t* priv, int64_t sample) {
+    // discard samples rendered before seeking
+    priv->buf.samples = 0;
+    priv->buf.bytes = 0;
+    priv->buf.consumed = 0;
+
+    libvgmstream_priv_resample_t* res = &priv->res;
+    if (res->rs) {
+        // seek to the first input sample the filter needs for target (position is in output rate)
+        if (sample < 0)
+            sample = 0;
+        if (!priv->pos.play_forever && sample > priv->pos.play_samples)
+            sample = priv->pos.play_samples;
+
+        int64_t input_sample = resampler_get_input_pos(res->rs, sample);
+        if (input_sample < 0)
+            input_sample = 0;
+        seek_vgmstream(priv->vgmstream, input_sample);
+
+        res->samples = 0;
+        res->consumed = 0;
+        res->input_current = priv->vgmstream->pstate.play_position;
+        res->output_current = sample;
+        resampler_reset(res->rs, sample, res->input_current);
+
+        priv->pos.current = sample;
+    }
+    else {
+        seek_vgmstream(priv->vgmstream, sample);
+
+        priv->pos.current = priv->vgmstream->pstate.play_position;
+    }
+
+    // may be set if stream was over (flagged like update_buf, so seeking to the end renders 0 samples before done)
+    priv->decode_done = !priv->pos.play_forever && priv->pos.current > priv->pos.play_samples;
+}
+
 LIBVGMSTREAM_API void libvgmstream_seek(libvgmstream_t* lib, int64_t sample) {
     if (!lib || !lib->priv)
         return;
@@ -134,9 +333,12 @@ LIBVGMSTREAM_API void libvgmstream_seek(libvgmstream_t* lib, int64_t sample) {
     if (!priv->vgmstream)
         return;
 
-    seek_vgmstream(priv->vgmstream, sample);
+    if (priv->async) {
+        api_async_seek(priv, sample);
+        return;
+    }
 
-    priv->pos.current = priv->vgmstream->pstate.play_position;
+    api_seek(priv, sample);
 }
 
 
@@ -145,6 +347,11 @@ LIBVGMSTREAM_API void libvgmstream_reset(libvgmstream_t* lib) {
         return;
 
     libvgmstream_priv_t* priv = lib->priv;
+    if (priv->async) {
+        api_async_reset(priv);
+        return;
+    }
+
     if (priv->vgmstream) {
         reset_vgmstream(priv->vgmstream);
     }
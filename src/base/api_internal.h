@@ -4,6 +4,7 @@
 #include "../util/log.h"
 #include "../vgmstream.h"
 #include "plugins.h"
+#include "resampler.h"
 
 #if LIBVGMSTREAM_ENABLE
 
@@ -12,6 +13,7 @@
 #define LIBVGMSTREAM_ERROR_DONE  -2
 
 #define INTERNAL_BUF_SAMPLES  1024
+#define INTERNAL_BUF_SAMPLES_MAX  0x10000
 
 /* self-note: various API functions are just bridges to internal stuff.
  * Rather than changing the internal stuff to handle API structs/etc,
@@ -21,6 +23,7 @@
 typedef struct {
     bool initialized;
     void* data;
+    void* planar_data;  /* final output if planar */
 
     /* config (output values channels/size after mixing, though buf may be as big as input size) */
     int max_samples;
@@ -40,6 +43,20 @@ typedef struct {
     int64_t current;
 } libvgmstream_priv_position_t;
 
+/* resampling stage after render (input values use the file's rate, output the final rate) */
+typedef struct {
+    resampler_t* rs;
+    void* data;         /* rendered samples before resampling */
+    int samples;
+    int consumed;
+
+    int64_t input_current;
+    int64_t input_play_samples;
+    int64_t output_current;
+} libvgmstream_priv_resample_t;
+
+typedef struct libvgmstream_priv_async_t libvgmstream_priv_async_t;
+
 /* vgmstream context/handle */
 typedef struct {
     libvgmstream_format_t fmt;  // externally exposed
@@ -48,17 +65,38 @@ typedef struct {
     libvgmstream_config_t cfg;  // internal copy
 
     VGMSTREAM* vgmstream;
+    STREAMFILE* sf;             // kept to reopen clones when vgmstream can't be copied
+    int stereo_track;           // from open options (for clones)
 
     libvgmstream_priv_buf_t buf;
     libvgmstream_priv_position_t pos;
+    libvgmstream_priv_resample_t res;
+    libvgmstream_priv_async_t* async; // background decoding (if enabled and possible)
+
+    int block_samples;          // max samples per render (from config)
+    bool direct_render;         // external bufs of output size can be rendered into
+    bool planar;                // output is deinterleaved (from config)
 
     bool decode_done;
 } libvgmstream_priv_t;
 
 
 void libvgmstream_priv_reset(libvgmstream_priv_t* priv, bool reset_buf);
+void api_reset_decoder(libvgmstream_priv_t* priv);
 libvgmstream_sample_t api_get_output_sample_type(libvgmstream_priv_t* priv);
 int api_get_sample_size(libvgmstream_sample_t sample_type);
+int api_get_block_samples(libvgmstream_priv_t* priv);
+
+int api_render(libvgmstream_priv_t* priv, bool deinterleave);
+void api_seek(libvgmstream_priv_t* priv, int64_t sample);
+
+void api_async_start(libvgmstream_priv_t* priv);
+void api_async_stop(libvgmstream_priv_t* priv);
+void api_async_seek(libvgmstream_priv_t* priv, int64_t sample);
+void api_async_reset(libvgmstream_priv_t* priv);
+int64_t api_async_get_position(libvgmstream_priv_t* priv);
+void api_async_lock(libvgmstream_priv_t* priv);
+void api_async_unlock(libvgmstream_priv_t* priv);
 
 STREAMFILE* open_api_streamfile(libstreamfile_t* libsf);
 
@@ -7,6 +7,7 @@
 #include "sbuf.h"
 #include "../util/log.h"
 #include "decode_state.h"
+#include "decode_parallel.h"
 
 
 static void* decode_state_init() {
@@ -144,6 +145,12 @@ void decode_free(VGMSTREAM* vgmstream) {
 }
 
 
+void decode_free_caches(void) {
+#ifdef VGM_USE_VORBIS
+    free_vorbis_custom_cache();
+#endif
+}
+
 void decode_seek(VGMSTREAM* vgmstream) {
     decode_state_reset(vgmstream);
 
@@ -365,6 +372,49 @@ void decode_reset(VGMSTREAM* vgmstream) {
     }
 }
 
+int32_t decode_skip(VGMSTREAM* vgmstream, int32_t samples) {
+    if (!vgmstream->codec_data || samples <= 0)
+        return 0;
+
+    /* only flat streams, where codecs handle all offsets */
+    if (vgmstream->layout_type != layout_none)
+        return 0;
+
+    /* loop points must be handled by the layout */
+    int32_t target_sample = vgmstream->current_sample + samples;
+    if (vgmstream->loop_flag) {
+        if (target_sample >= vgmstream->loop_end_sample)
+            return 0;
+        if (!vgmstream->hit_loop && target_sample > vgmstream->loop_start_sample)
+            return 0;
+    }
+    else if (target_sample > vgmstream->num_samples) {
+        return 0;
+    }
+
+    int32_t skipped = 0;
+
+#ifdef VGM_USE_MPEG
+    if (vgmstream->coding_type == coding_MPEG_custom ||
+        vgmstream->coding_type == coding_MPEG_ealayer3 ||
+        vgmstream->coding_type == coding_MPEG_layer1 ||
+        vgmstream->coding_type == coding_MPEG_layer2 ||
+        vgmstream->coding_type == coding_MPEG_layer3) {
+        skipped = skip_mpeg(vgmstream, samples);
+    }
+#endif
+
+#ifdef VGM_USE_ATRAC9
+    if (vgmstream->coding_type == coding_ATRAC9) {
+        skipped = skip_atrac9(vgmstream, samples);
+    }
+#endif
+
+    vgmstream->current_sample += skipped;
+    vgmstream->samples_into_block += skipped;
+    return skipped;
+}
+
 
 /* Get the number of samples of a single frame (smallest self-contained sample group, 1/N channels) */
 int decode_get_samples_per_frame(VGMSTREAM* vgmstream) {
@@ -912,6 +962,10 @@ decode_fail:
  * more than one frame if configured above to do so).
  * Called by layouts since they handle samples written/to_do */
 void decode_vgmstream(VGMSTREAM* vgmstream, int samples_filled, int samples_to_do, sample_t* buffer) {
+    /* simple codecs may be decoded later in parallel */
+    if (vgmstream->parallel_data && decode_parallel_queue(vgmstream, samples_filled, samples_to_do, buffer))
+        return;
+
     sbuf_t sbuf_tmp = {0};
     sbuf_t* sbuf = &sbuf_tmp;
     sbuf_init_s16(sbuf, buffer,  samples_filled + samples_to_do, vgmstream->channels);
@@ -1690,9 +1744,24 @@ int decode_get_samples_to_do(int samples_this_block, int samples_per_frame, VGMS
 
 
 /* Detect loop start and save values, or detect loop end and restore (loop back). Returns true if loop was done. */
+bool decode_keeps_loop_history(VGMSTREAM* vgmstream) {
+    return vgmstream->meta_type == meta_DSP_STD ||
+           vgmstream->meta_type == meta_DSP_RS03 ||
+           vgmstream->meta_type == meta_DSP_CSTR ||
+           vgmstream->coding_type == coding_PSX ||
+           vgmstream->coding_type == coding_PSX_badflags;
+}
+
 bool decode_do_loop(VGMSTREAM* vgmstream) {
     //if (!vgmstream->loop_flag) return false;
 
+    /* loops save/restore channel state so pending frames must be decoded first */
+    if (vgmstream->parallel_data &&
+            (vgmstream->current_sample == vgmstream->loop_end_sample ||
+            (!vgmstream->hit_loop && vgmstream->current_sample == vgmstream->loop_start_sample))) {
+        decode_parallel_flush(vgmstream);
+    }
+
     /* is this the loop end? = new loop, continue from loop_start_sample */
     if (vgmstream->current_sample == vgmstream->loop_end_sample) {
 
@@ -1705,11 +1774,7 @@ bool decode_do_loop(VGMSTREAM* vgmstream) {
         }
 
         /* against everything I hold sacred, preserve adpcm history before looping for certain types */
-        if (vgmstream->meta_type == meta_DSP_STD ||
-            vgmstream->meta_type == meta_DSP_RS03 ||
-            vgmstream->meta_type == meta_DSP_CSTR ||
-            vgmstream->coding_type == coding_PSX ||
-            vgmstream->coding_type == coding_PSX_badflags) {
+        if (decode_keeps_loop_history(vgmstream)) {
             for (int ch = 0; ch < vgmstream->channels; ch++) {
                 vgmstream->loop_ch[ch].adpcm_history1_16 = vgmstream->ch[ch].adpcm_history1_16;
                 vgmstream->loop_ch[ch].adpcm_history2_16 = vgmstream->ch[ch].adpcm_history2_16;
@@ -8,10 +8,20 @@ void decode_free(VGMSTREAM* vgmstream);
 void decode_seek(VGMSTREAM* vgmstream);
 void decode_reset(VGMSTREAM* vgmstream);
 
+/* Frees process-wide codec caches (shared between files, so only once no decoders are left). */
+void decode_free_caches(void);
+
+/* Moves forward if the codec can do it faster than decoding + discarding (for flat layouts and not past
+ * loop points). Returns skipped samples, that don't need to be decoded. */
+int32_t decode_skip(VGMSTREAM* vgmstream, int32_t samples);
+
 /* Decode samples into the buffer. Assume that we have written samples_filled into the
  * buffer already, and we have samples_to_do consecutive samples ahead of us. */
 void decode_vgmstream(VGMSTREAM* vgmstream, int samples_filled, int samples_to_do, sample_t* buffer);
 
+/* True if ADPCM history at loop end is kept when looping (so loops don't sound the same as the first playthrough). */
+bool decode_keeps_loop_history(VGMSTREAM* vgmstream);
+
 /* Detect loop start and save values, or detect loop end and restore (loop back). Returns true if loop was done. */
 bool decode_do_loop(VGMSTREAM* vgmstream);
 
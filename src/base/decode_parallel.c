@@ -0,0 +1,513 @@
+#include "../vgmstream.h"
+#include "../layout/layout.h"
+#include "../coding/coding.h"
+#include "../util/sf_utils.h"
+#include "../util/threads.h"
+#include "decode_parallel.h"
+#include "plugins.h"
+
+
+/* PARALLEL DECODING
+ * Simple codecs (DSP/PSX/ADX/IMA/PCM...) keep all state in each VGMSTREAMCHANNEL, so channels could be
+ * decoded at the same time. However layouts call decode_vgmstream once per frame (~14-32 samples), then
+ * move offsets around, so threading each call would be mostly sync overhead.
+ *
+ * Instead decode_vgmstream queues each call (plus current channel offsets, the only thing layouts change
+ * between calls), and once the layout is done (or needs channel state) queued frames are decoded
+ * by N threads, each replaying all frames in order for a group of channels. Since each channel still
+ * decodes the same frames in the same order the output is the same as decoding serially.
+ *
+ * Channels may share a STREAMFILE (not thread-safe) so each channel gets its own when enabled.
+ *
+ * Layered layouts may also render each layer in a thread (see layered.c), using the same pool. Pool calls
+ * from inside the pool are done inline, so layers' channels are decoded serially in that case.
+ * Segmented layouts may prefetch the next segment in a background thread too (see segmented.c).
+ */
+
+#define PARALLEL_MIN_JOBS 64
+
+typedef struct {
+    sample_t* buffer;               /* already adjusted to samples_filled */
+    int32_t samples_into_block;
+    int samples_to_do;
+} parallel_job_t;
+
+typedef struct {
+    vgm_pool_t* pool;               /* may be shared with sub-VGMSTREAMs */
+    bool owns_pool;
+
+    int channels;
+    int groups;                     /* channel groups decoded in parallel */
+    bool enabled;                   /* codec/layout can be queued */
+
+    parallel_job_t* jobs;
+    off_t* job_offsets;             /* channel offsets per job (jobs * channels) */
+    int jobs_count;
+    int jobs_max;
+
+    off_t* current_offsets;         /* layout's offsets, restored after flush */
+    VGMSTREAM* vgmstream;           /* current owner during flush */
+} decode_parallel_t;
+
+
+static bool is_codec_supported(VGMSTREAM* vgmstream) {
+    switch (vgmstream->coding_type) {
+        case coding_CRI_ADX:
+        case coding_CRI_ADX_exp:
+        case coding_CRI_ADX_fixed:
+        case coding_CRI_ADX_enc_8:
+        case coding_CRI_ADX_enc_9:
+        case coding_NGC_DSP:
+        case coding_NGC_DSP_subint:
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM16_int:
+        case coding_PCM8:
+        case coding_PCM8_int:
+        case coding_PCM8_U:
+        case coding_PCM8_U_int:
+        case coding_PCM8_SB:
+        case coding_ULAW:
+        case coding_ULAW_int:
+        case coding_ALAW:
+        case coding_PCMFLOAT:
+        case coding_PCM24LE:
+        case coding_PCM24BE:
+        case coding_PCM32LE:
+        case coding_NDS_IMA:
+        case coding_DAT4_IMA:
+        case coding_IMA:
+        case coding_IMA_int:
+        case coding_DVI_IMA:
+        case coding_DVI_IMA_int:
+        case coding_PSX:
+        case coding_PSX_badflags:
+        case coding_PSX_cfg:
+        case coding_PSX_pivotal:
+        case coding_HEVAG:
+            return true;
+        case coding_MSADPCM:
+        case coding_MSADPCM_mono:
+            return vgmstream->channels == 1 || vgmstream->coding_type == coding_MSADPCM_mono;
+        default:
+            return false;
+    }
+}
+
+static bool is_layout_supported(VGMSTREAM* vgmstream) {
+    /* decoders that move offsets can't be queued (see decode_uses_internal_offset_updates) */
+    if (vgmstream->codec_internal_updates)
+        return false;
+
+    switch (vgmstream->layout_type) {
+        case layout_segmented:
+        case layout_layered:
+            return false; /* handled per sub-VGMSTREAM */
+        default:
+            return true;
+    }
+}
+
+/* same as decode_vgmstream's, for a single channel */
+static void decode_channel(VGMSTREAM* vgmstream, int ch, parallel_job_t* job) {
+    VGMSTREAMCHANNEL* stream = &vgmstream->ch[ch];
+    sample_t* buffer = job->buffer + ch;
+    int channels = vgmstream->channels;
+    int32_t first_sample = job->samples_into_block;
+    int samples_to_do = job->samples_to_do;
+
+    switch (vgmstream->coding_type) {
+        case coding_CRI_ADX:
+        case coding_CRI_ADX_exp:
+        case coding_CRI_ADX_fixed:
+        case coding_CRI_ADX_enc_8:
+        case coding_CRI_ADX_enc_9:
+            decode_adx(stream, buffer, channels, first_sample, samples_to_do,
+                    vgmstream->interleave_block_size, vgmstream->coding_type, vgmstream->codec_config);
+            break;
+        case coding_NGC_DSP:
+            decode_ngc_dsp(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_NGC_DSP_subint:
+            decode_ngc_dsp_subint(stream, buffer, channels, first_sample, samples_to_do, ch,
+                    vgmstream->interleave_block_size);
+            break;
+
+        case coding_PCM16LE:
+            decode_pcm16le(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM16BE:
+            decode_pcm16be(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM16_int:
+            decode_pcm16_int(stream, buffer, channels, first_sample, samples_to_do, vgmstream->codec_endian);
+            break;
+        case coding_PCM8:
+            decode_pcm8(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM8_int:
+            decode_pcm8_int(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM8_U:
+            decode_pcm8_unsigned(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM8_U_int:
+            decode_pcm8_unsigned_int(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM8_SB:
+            decode_pcm8_sb(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_ULAW:
+            decode_ulaw(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_ULAW_int:
+            decode_ulaw_int(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_ALAW:
+            decode_alaw(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCMFLOAT:
+            decode_pcmfloat(stream, buffer, channels, first_sample, samples_to_do, vgmstream->codec_endian);
+            break;
+        case coding_PCM24LE:
+            decode_pcm24le(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM24BE:
+            decode_pcm24be(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_PCM32LE:
+            decode_pcm32le(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+
+        case coding_NDS_IMA:
+            decode_nds_ima(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_DAT4_IMA:
+            decode_dat4_ima(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+        case coding_IMA:
+        case coding_IMA_int:
+        case coding_DVI_IMA:
+        case coding_DVI_IMA_int: {
+            int is_stereo = (channels > 1 && vgmstream->coding_type == coding_IMA)
+                    || (channels > 1 && vgmstream->coding_type == coding_DVI_IMA);
+            int is_high_first = vgmstream->coding_type == coding_DVI_IMA
+                    || vgmstream->coding_type == coding_DVI_IMA_int;
+            decode_standard_ima(stream, buffer, channels, first_sample, samples_to_do, ch,
+                    is_stereo, is_high_first);
+            break;
+        }
+
+        case coding_PSX:
+            decode_psx(stream, buffer, channels, first_sample, samples_to_do, 0, vgmstream->codec_config);
+            break;
+        case coding_PSX_badflags:
+            decode_psx(stream, buffer, channels, first_sample, samples_to_do, 1, vgmstream->codec_config);
+            break;
+        case coding_PSX_cfg:
+            decode_psx_configurable(stream, buffer, channels, first_sample, samples_to_do,
+                    vgmstream->frame_size, vgmstream->codec_config);
+            break;
+        case coding_PSX_pivotal:
+            decode_psx_pivotal(stream, buffer, channels, first_sample, samples_to_do, vgmstream->frame_size);
+            break;
+        case coding_HEVAG:
+            decode_hevag(stream, buffer, channels, first_sample, samples_to_do);
+            break;
+
+        case coding_MSADPCM:
+        case coding_MSADPCM_mono:
+            decode_msadpcm_mono(vgmstream, buffer, channels, first_sample, samples_to_do, ch,
+                    vgmstream->codec_config);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* decodes all queued jobs for one group of channels */
+static void decode_group(void* ctx, int index) {
+    decode_parallel_t* data = ctx;
+    VGMSTREAM* vgmstream = data->vgmstream;
+    int channels = data->channels;
+    int ch_start = index * channels / data->groups;
+    int ch_end = (index + 1) * channels / data->groups;
+
+    for (int i = 0; i < data->jobs_count; i++) {
+        parallel_job_t* job = &data->jobs[i];
+        off_t* offsets = &data->job_offsets[i * channels];
+
+        for (int ch = ch_start; ch < ch_end; ch++) {
+            vgmstream->ch[ch].offset = offsets[ch];
+            decode_channel(vgmstream, ch, job);
+        }
+    }
+}
+
+void decode_parallel_flush(VGMSTREAM* vgmstream) {
+    decode_parallel_t* data = vgmstream->parallel_data;
+    if (!data || !data->jobs_count)
+        return;
+
+    for (int ch = 0; ch < data->channels; ch++) {
+        data->current_offsets[ch] = vgmstream->ch[ch].offset;
+    }
+
+    data->vgmstream = vgmstream;
+    vgm_pool_run(data->pool, data->groups, decode_group, data);
+    data->vgmstream = NULL;
+
+    for (int ch = 0; ch < data->channels; ch++) {
+        vgmstream->ch[ch].offset = data->current_offsets[ch];
+    }
+
+    data->jobs_count = 0;
+}
+
+bool decode_parallel_queue(VGMSTREAM* vgmstream, int samples_filled, int samples_to_do, sample_t* buffer) {
+    decode_parallel_t* data = vgmstream->parallel_data;
+    if (!data || !data->enabled)
+        return false;
+
+    if (data->jobs_count >= data->jobs_max) {
+        int jobs_max = data->jobs_max * 2;
+        parallel_job_t* jobs = realloc(data->jobs, jobs_max * sizeof(parallel_job_t));
+        if (!jobs) goto fail;
+        data->jobs = jobs;
+
+        off_t* job_offsets = realloc(data->job_offsets, jobs_max * data->channels * sizeof(off_t));
+        if (!job_offsets) goto fail;
+        data->job_offsets = job_offsets;
+
+        data->jobs_max = jobs_max;
+    }
+
+    parallel_job_t* job = &data->jobs[data->jobs_count];
+    job->buffer = buffer + samples_filled * vgmstream->channels;
+    job->samples_into_block = vgmstream->samples_into_block;
+    job->samples_to_do = samples_to_do;
+
+    off_t* offsets = &data->job_offsets[data->jobs_count * data->channels];
+    for (int ch = 0; ch < data->channels; ch++) {
+        offsets[ch] = vgmstream->ch[ch].offset;
+    }
+
+    data->jobs_count++;
+    return true;
+fail:
+    /* decode what we have and let caller handle current frame */
+    decode_parallel_flush(vgmstream);
+    return false;
+}
+
+
+static bool reopen_channel_streamfile(VGMSTREAM* vgmstream, int ch) {
+    char filename[PATH_LIMIT];
+    STREAMFILE* sf = vgmstream->ch[ch].streamfile;
+
+    get_streamfile_name(sf, filename, sizeof(filename));
+    STREAMFILE* new_sf = open_streamfile(sf, filename);
+    if (!new_sf) return false;
+
+    /* clones are shallow copies and must point to the same file (closed via ch[] only) */
+    vgmstream->ch[ch].streamfile = new_sf;
+    if (vgmstream->start_ch && vgmstream->start_ch[ch].streamfile == sf)
+        vgmstream->start_ch[ch].streamfile = new_sf;
+    if (vgmstream->loop_ch && vgmstream->loop_ch[ch].streamfile == sf)
+        vgmstream->loop_ch[ch].streamfile = new_sf;
+    return true;
+}
+
+static bool has_streamfile(VGMSTREAM* vgmstream, int channels, STREAMFILE* sf) {
+    for (int i = 0; i < channels; i++) {
+        if (vgmstream->ch[i].streamfile == sf)
+            return true;
+    }
+    return false;
+}
+
+/* each channel must read from its own STREAMFILE as they aren't thread-safe */
+static bool split_streamfiles(VGMSTREAM* vgmstream) {
+
+    for (int ch = 1; ch < vgmstream->channels; ch++) {
+        STREAMFILE* sf = vgmstream->ch[ch].streamfile;
+        if (!sf || !has_streamfile(vgmstream, ch, sf))
+            continue;
+
+        if (!reopen_channel_streamfile(vgmstream, ch))
+            return false;
+    }
+
+    return true;
+}
+
+/* Layers can only be rendered at the same time if all their reads go through ch[] (that can be split). Some codecs
+ * keep a STREAMFILE in codec_data that may be the same between layers (ex. MP4 AAC, Ogg Vorbis), and sub-layouts
+ * have their own layers/segments, so those layers are rendered in order instead. */
+static bool is_layer_parallel_supported(layered_layout_data* layout_data) {
+    for (int i = 0; i < layout_data->layer_count; i++) {
+        VGMSTREAM* layer = layout_data->layers[i];
+        if (layer->codec_data || layer->layout_data)
+            return false;
+    }
+    return true;
+}
+
+/* same for layers, that are rendered at the same time */
+static bool split_layer_streamfiles(layered_layout_data* layout_data) {
+
+    for (int i = 1; i < layout_data->layer_count; i++) {
+        VGMSTREAM* layer = layout_data->layers[i];
+
+        for (int ch = 0; ch < layer->channels; ch++) {
+            STREAMFILE* sf = layer->ch[ch].streamfile;
+            if (!sf)
+                continue;
+
+            bool is_shared = false;
+            for (int j = 0; j < i; j++) {
+                VGMSTREAM* prev = layout_data->layers[j];
+                if (has_streamfile(prev, prev->channels, sf)) {
+                    is_shared = true;
+                    break;
+                }
+            }
+            if (!is_shared)
+                continue;
+
+            if (!reopen_channel_streamfile(layer, ch))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static void free_parallel_data(decode_parallel_t* data) {
+    if (!data)
+        return;
+    if (data->owns_pool)
+        vgm_pool_free(data->pool);
+    free(data->jobs);
+    free(data->job_offsets);
+    free(data->current_offsets);
+    free(data);
+}
+
+static bool setup_parallel(VGMSTREAM* vgmstream, vgm_pool_t* pool, int modes) {
+    decode_parallel_t* data = NULL;
+
+    data = calloc(1, sizeof(decode_parallel_t));
+    if (!data) goto fail;
+
+    data->pool = pool;
+    data->channels = vgmstream->channels;
+
+    data->groups = vgm_pool_get_threads(pool);
+    if (data->groups > data->channels)
+        data->groups = data->channels;
+
+    data->enabled = (modes & VGM_THREADS_CHANNELS) && data->groups > 1
+            && is_codec_supported(vgmstream) && is_layout_supported(vgmstream);
+    if (data->enabled) {
+        data->jobs_max = PARALLEL_MIN_JOBS;
+        data->jobs = malloc(data->jobs_max * sizeof(parallel_job_t));
+        data->job_offsets = malloc(data->jobs_max * data->channels * sizeof(off_t));
+        data->current_offsets = malloc(data->channels * sizeof(off_t));
+        if (!data->jobs || !data->job_offsets || !data->current_offsets) goto fail;
+
+        if (!split_streamfiles(vgmstream)) goto fail;
+    }
+
+    /* sub-VGMSTREAMs share the pool (calls from inside the pool are run inline so this is fine) */
+    if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data* layout_data = vgmstream->layout_data;
+        for (int i = 0; i < layout_data->segment_count; i++) {
+            if (!setup_parallel(layout_data->segments[i], pool, modes))
+                goto fail;
+        }
+
+        /* not part of the pool since it must run while the main thread decodes */
+        if (modes & VGM_THREADS_SEGMENTS) {
+            if (!setup_layout_segmented_prefetch(layout_data, true))
+                goto fail;
+        }
+    }
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data* layout_data = vgmstream->layout_data;
+        for (int i = 0; i < layout_data->layer_count; i++) {
+            if (!setup_parallel(layout_data->layers[i], pool, modes))
+                goto fail;
+        }
+
+        /* layers are independent so they can be rendered at the same time too */
+        if ((modes & VGM_THREADS_LAYERS) && layout_data->layer_count > 1 && is_layer_parallel_supported(layout_data)) {
+            if (!split_layer_streamfiles(layout_data))
+                goto fail;
+            if (!setup_layout_layered_parallel(layout_data, pool))
+                goto fail;
+        }
+    }
+
+    vgmstream->parallel_data = data;
+    /* must survive resets */
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->parallel_data = data;
+    return true;
+fail:
+    free_parallel_data(data);
+    return false;
+}
+
+static void disable_parallel(VGMSTREAM* vgmstream) {
+    if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data* layout_data = vgmstream->layout_data;
+        for (int i = 0; i < layout_data->segment_count; i++) {
+            disable_parallel(layout_data->segments[i]);
+        }
+        setup_layout_segmented_prefetch(layout_data, false);
+    }
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data* layout_data = vgmstream->layout_data;
+        for (int i = 0; i < layout_data->layer_count; i++) {
+            disable_parallel(layout_data->layers[i]);
+        }
+        setup_layout_layered_parallel(layout_data, NULL);
+    }
+
+    decode_parallel_free(vgmstream);
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->parallel_data = NULL;
+}
+
+bool decode_parallel_enable(VGMSTREAM* vgmstream, int threads, int modes) {
+    if (!vgmstream || vgmstream->parallel_data)
+        return false;
+    if (threads <= 1)
+        return true;
+
+    vgm_pool_t* pool = vgm_pool_init(threads);
+    if (!pool)
+        return false;
+
+    if (!setup_parallel(vgmstream, pool, modes)) {
+        /* some sub-VGMSTREAMs may be set up already (streamfiles stay split but that's harmless) */
+        disable_parallel(vgmstream);
+        vgm_pool_free(pool);
+        return false;
+    }
+
+    /* only the main VGMSTREAM frees the pool */
+    decode_parallel_t* data = vgmstream->parallel_data;
+    data->owns_pool = true;
+    return true;
+}
+
+void decode_parallel_free(VGMSTREAM* vgmstream) {
+    if (!vgmstream || !vgmstream->parallel_data)
+        return;
+
+    free_parallel_data(vgmstream->parallel_data);
+    vgmstream->parallel_data = NULL;
+}
@@ -0,0 +1,22 @@
+#ifndef _DECODE_PARALLEL_H
+#define _DECODE_PARALLEL_H
+
+#include "../vgmstream.h"
+
+/* Enables decoding in parallel using up to N threads (N <= 1 does nothing), modes being VGM_THREADS_* flags:
+ * - channels: only for simple codecs where each channel's state is independent, others are decoded normally
+ * - layers: layered layouts render each layer in a thread
+ * - segments: segmented layouts render the start of next segment in a background thread
+ * Must be called once the VGMSTREAM is set up and before decoding. Returns false if not possible. */
+bool decode_parallel_enable(VGMSTREAM* vgmstream, int threads, int modes);
+
+void decode_parallel_free(VGMSTREAM* vgmstream);
+
+/* Queues current frame to be decoded later (called by decode_vgmstream). Returns false if not handled. */
+bool decode_parallel_queue(VGMSTREAM* vgmstream, int samples_filled, int samples_to_do, sample_t* buffer);
+
+/* Decodes all queued frames. Must be called before anything that reads decoded samples or
+ * channel state (end of layout render, loop save/restore, block changes). */
+void decode_parallel_flush(VGMSTREAM* vgmstream);
+
+#endif
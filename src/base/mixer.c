@@ -11,8 +11,8 @@
  * Mixer modifies decoded sample buffer before final output. This is implemented
  * with simplicity in mind rather than performance. Process:
  * - detect if mixing applies at current moment or exit (mini performance optimization)
- * - copy/upgrade buf to float mixbuf if needed
- * - do mixing ops
+ * - copy/upgrade buf to float mixbuf if needed (or mix s16 directly for simple chains)
+ * - do mixing ops (linear ops are combined into channel matrices on setup, see mixer_ops_matrix.c)
  * - copy/downgrade mixbuf to original buf if needed
  * 
  * Mixing ops are added by a meta (ex. TXTP) or plugins through API. Non-sensical config
@@ -44,10 +44,29 @@ fail:
 void mixer_free(mixer_t* mixer) {
     if (!mixer) return;
 
+    mixer_free_stages(mixer);
     free(mixer->mixbuf);
     free(mixer);
 }
 
+mixer_t* mixer_clone(mixer_t* mixer) {
+    if (!mixer) return NULL;
+
+    mixer_t* new_mixer = malloc(sizeof(mixer_t));
+    if (!new_mixer) return NULL;
+
+    /* same ops, but buffers and compiled stages are made when enabled again */
+    *new_mixer = *mixer;
+    new_mixer->active = false;
+    new_mixer->compiled = false;
+    new_mixer->stages = NULL;
+    new_mixer->stages_count = 0;
+    new_mixer->is_fixed_s16 = false;
+    new_mixer->mixbuf = NULL;
+
+    return new_mixer;
+}
+
 void mixer_update_channel(mixer_t* mixer) {
     if (!mixer) return;
 
@@ -70,6 +89,22 @@ bool mixer_is_active(mixer_t* mixer) {
     return false;
 }
 
+static void mixer_apply_op(mixer_t* mixer, int32_t sample_count, mix_op_t* mix) {
+    //TO-DO: set callback
+    switch(mix->type) {
+        case MIX_SWAP:      mixer_op_swap(mixer, sample_count, mix); break;
+        case MIX_ADD:       mixer_op_add(mixer, sample_count, mix); break;
+        case MIX_VOLUME:    mixer_op_volume(mixer, sample_count, mix); break;
+        case MIX_LIMIT:     mixer_op_limit(mixer, sample_count, mix); break;
+        case MIX_UPMIX:     mixer_op_upmix(mixer, sample_count, mix); break;
+        case MIX_DOWNMIX:   mixer_op_downmix(mixer, sample_count, mix); break;
+        case MIX_KILLMIX:   mixer_op_killmix(mixer, sample_count, mix); break;
+        case MIX_FADE:      mixer_op_fade(mixer, sample_count, mix); break;
+        default:
+            break;
+    }
+}
+
 void mixer_process(mixer_t* mixer, sbuf_t* sbuf, int32_t current_pos) {
 
     /* external */
@@ -88,6 +123,13 @@ void mixer_process(mixer_t* mixer, sbuf_t* sbuf, int32_t current_pos) {
         mixer->current_subpos = current_pos;
     }
 
+    // simple volume/downmix chains can be done over s16 directly (no fades so position doesn't matter)
+    if (mixer->is_fixed_s16 && sbuf->fmt == SFMT_S16 && (mixer->force_type == SFMT_NONE || mixer->force_type == SFMT_S16)) {
+        mixer_op_matrix_s16(mixer, sbuf);
+        sbuf->channels = mixer->output_channels;
+        return;
+    }
+
     // remix to temp buf for mixing (somehow using float buf rather than int32 is faster?)
     sbuf_copy_to_f32(mixer->mixbuf, sbuf);
 
@@ -95,21 +137,19 @@ void mixer_process(mixer_t* mixer, sbuf_t* sbuf, int32_t current_pos) {
     // - 2ch w/ "1+2,1u" = ch1+ch2, ch1(add and push rest) = 3ch: ch1' ch1+ch2 ch2
     // - 2ch w/ "1u"     = downmix to 1ch (current_channels decreases once)
     mixer->current_channels = mixer->input_channels;
-    for (int m = 0; m < mixer->chain_count; m++) {
-        mix_op_t* mix = &mixer->chain[m];
-
-        //TO-DO: set callback
-        switch(mix->type) {
-            case MIX_SWAP:      mixer_op_swap(mixer, sbuf->filled, mix); break;
-            case MIX_ADD:       mixer_op_add(mixer, sbuf->filled, mix); break;
-            case MIX_VOLUME:    mixer_op_volume(mixer, sbuf->filled, mix); break;
-            case MIX_LIMIT:     mixer_op_limit(mixer, sbuf->filled, mix); break;
-            case MIX_UPMIX:     mixer_op_upmix(mixer, sbuf->filled, mix); break;
-            case MIX_DOWNMIX:   mixer_op_downmix(mixer, sbuf->filled, mix); break;
-            case MIX_KILLMIX:   mixer_op_killmix(mixer, sbuf->filled, mix); break;
-            case MIX_FADE:      mixer_op_fade(mixer, sbuf->filled, mix);
-            default:
-                break;
+    if (mixer->compiled) {
+        for (int i = 0; i < mixer->stages_count; i++) {
+            mix_stage_t* stage = &mixer->stages[i];
+
+            if (stage->op)
+                mixer_apply_op(mixer, sbuf->filled, stage->op);
+            else
+                mixer_op_matrix(mixer, sbuf->filled, stage);
+        }
+    }
+    else {
+        for (int m = 0; m < mixer->chain_count; m++) {
+            mixer_apply_op(mixer, sbuf->filled, &mixer->chain[m]);
         }
     }
 
@@ -12,8 +12,6 @@ static inline float get_fade_gain_curve(char shape, float index) {
         return index;
     }
 
-    //TODO optimizations: interleave calcs
-
     /* (curve math mostly from SoX/FFmpeg) */
     switch(shape) {
         /* 2.5f in L/E 'pow' is the attenuation factor, where 5.0 (100db) is common but a bit fast
@@ -112,33 +110,71 @@ static bool get_fade_gain(mix_op_t* op, float* out_cur_vol, int32_t current_subp
     return true;
 }
 
+/* Curves are smooth enough to be calculated every N samples and linearly interpolated in between, rather than
+ * calling expf/cosf/etc per sample. With long fades (at least N*1024 samples, so index changes under 1/1024
+ * per step) max gain error is ~4e-6 (exponential, the worst case), or ~1/8 of a PCM16 step at full scale.
+ * Parabola (sqrt) is exact, as its slope near the end is too steep, as are fade edges (see above). */
+#define MIXER_FADE_STEP  64
+
+static bool is_fade_interpolable(mix_op_t* op) {
+    if (op->shape == 'p')
+        return false;
+    return op->time_end - op->time_start >= MIXER_FADE_STEP * 1024;
+}
+
 void mixer_op_fade(mixer_t* mixer, int32_t sample_count, mix_op_t* mix) {
     float* sbuf = mixer->mixbuf;
     float new_gain = 0.0f;
 
     int channels = mixer->current_channels;
-    int32_t current_subpos = mixer->current_subpos;
-
-    //TODO optimize for case 0?
-    for (int s = 0; s < sample_count; s++) {
-        bool fade_applies = get_fade_gain(mix, &new_gain, current_subpos);
-        if (!fade_applies) //TODO optimize?
-            continue;
+    int32_t current_subpos = mixer->current_subpos; /* each fade op starts from the block's position */
+    bool can_interpolate = is_fade_interpolable(mix);
+    int32_t edge = (mix->time_end - mix->time_start) / 10000 + 1;
+
+    int s = 0;
+    while (s < sample_count) {
+        /* steps are aligned to stream positions, so results don't depend on block sizes */
+        int32_t step_start = current_subpos - (current_subpos % MIXER_FADE_STEP);
+        int step_samples = step_start + MIXER_FADE_STEP - current_subpos;
+        if (step_samples > sample_count - s)
+            step_samples = sample_count - s;
+
+        /* whole step within fade: calc gain at both ends and interpolate
+         * (except near fade edges, where get_fade_gain_curve switches to linear) */
+        bool interpolate = can_interpolate && step_start >= mix->time_start + edge && step_start + MIXER_FADE_STEP <= mix->time_end - edge;
+        float gain_start = 0.0f, gain_step = 0.0f;
+        if (interpolate) {
+            float gain_end = 0.0f;
+            get_fade_gain(mix, &gain_start, step_start);
+            get_fade_gain(mix, &gain_end, step_start + MIXER_FADE_STEP);
+            gain_step = (gain_end - gain_start) / MIXER_FADE_STEP;
+        }
 
-        if (mix->ch_dst < 0) {
-            for (int ch = 0; ch < channels; ch++) {
-                sbuf[ch] = sbuf[ch] * new_gain;
+        for (int i = 0; i < step_samples; i++) {
+            bool fade_applies = true;
+
+            if (interpolate)
+                new_gain = gain_start + gain_step * (current_subpos - step_start);
+            else
+                fade_applies = get_fade_gain(mix, &new_gain, current_subpos);
+
+            if (fade_applies) {
+                if (mix->ch_dst < 0) {
+                    for (int ch = 0; ch < channels; ch++) {
+                        sbuf[ch] = sbuf[ch] * new_gain;
+                    }
+                }
+                else {
+                    sbuf[mix->ch_dst] = sbuf[mix->ch_dst] * new_gain;
+                }
             }
-        }
-        else {
-            sbuf[mix->ch_dst] = sbuf[mix->ch_dst] * new_gain;
+
+            sbuf += channels;
+            current_subpos++;
         }
 
-        sbuf += channels;
-        current_subpos++;
+        s += step_samples;
     }
-
-    mixer->current_subpos = current_subpos;
 }
 
 
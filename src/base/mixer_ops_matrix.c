@@ -0,0 +1,355 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../util/vgmstream_limits.h"
+#include "../util/samples_ops.h"
+#include "mixer_priv.h"
+
+/* Most mixing ops (swap/add/volume/upmix/downmix/killmix) are linear and don't depend on position,
+ * so consecutive ones can be combined into a single channel matrix (out_ch = sum of in_ch * vol) when
+ * mixing is set up, then applied in one pass over mixbuf rather than one pass per op. Long chains are
+ * common (macros for downmixing/layering add one op per channel combination).
+ *
+ * Fades (position-dependent) and limits (not linear) are kept as separate stages in between matrices.
+ * Results may differ from applying ops one by one in the last float bits (different operation order),
+ * which isn't audible.
+ *
+ * If the whole chain ends up as a single matrix with moderate volumes, s16 input can be mixed in place with
+ * Q15 fixed point volumes instead of converting to float and back (mainly helps slower CPUs). Output may
+ * differ by 1 LSB from float mixing as volumes are rounded to 1/32768. */
+
+/* sum of abs Q15 volumes per output must fit so s16 * qvol accumulates in int32 */
+#define MIX_Q15_MAX  65535
+
+typedef struct {
+    double vol[VGMSTREAM_MAX_CHANNELS][VGMSTREAM_MAX_CHANNELS]; /* [out][in] */
+    int input_channels;
+    int output_channels;
+} mix_matrix_t;
+
+
+static void matrix_reset(mix_matrix_t* mtx, int channels) {
+    memset(mtx->vol, 0, sizeof(mtx->vol));
+    for (int ch = 0; ch < channels; ch++) {
+        mtx->vol[ch][ch] = 1.0;
+    }
+    mtx->input_channels = channels;
+    mtx->output_channels = channels;
+}
+
+static bool matrix_is_identity(mix_matrix_t* mtx) {
+    if (mtx->input_channels != mtx->output_channels)
+        return false;
+
+    for (int out = 0; out < mtx->output_channels; out++) {
+        for (int in = 0; in < mtx->input_channels; in++) {
+            if (mtx->vol[out][in] != (out == in ? 1.0 : 0.0))
+                return false;
+        }
+    }
+    return true;
+}
+
+/* returns volume if matrix only changes volume of all channels equally, or 0 */
+static double matrix_get_volume(mix_matrix_t* mtx) {
+    if (mtx->input_channels != mtx->output_channels)
+        return 0.0;
+
+    double vol = mtx->vol[0][0];
+    for (int out = 0; out < mtx->output_channels; out++) {
+        for (int in = 0; in < mtx->input_channels; in++) {
+            if (mtx->vol[out][in] != (out == in ? vol : 0.0))
+                return 0.0;
+        }
+    }
+    return vol;
+}
+
+/* same as each mixer_op_x, but changing matrix rows (each row is an output channel) */
+static void matrix_apply_op(mix_matrix_t* mtx, mix_op_t* op) {
+    int channels = mtx->output_channels;
+    size_t row_size = sizeof(mtx->vol[0]);
+
+    switch(op->type) {
+        case MIX_SWAP: {
+            double temp[VGMSTREAM_MAX_CHANNELS];
+            memcpy(temp, mtx->vol[op->ch_dst], row_size);
+            memcpy(mtx->vol[op->ch_dst], mtx->vol[op->ch_src], row_size);
+            memcpy(mtx->vol[op->ch_src], temp, row_size);
+            break;
+        }
+
+        case MIX_ADD:
+            for (int in = 0; in < mtx->input_channels; in++) {
+                mtx->vol[op->ch_dst][in] += mtx->vol[op->ch_src][in] * op->vol;
+            }
+            break;
+
+        case MIX_VOLUME:
+            for (int out = 0; out < channels; out++) {
+                if (op->ch_dst >= 0 && out != op->ch_dst)
+                    continue;
+                for (int in = 0; in < mtx->input_channels; in++) {
+                    mtx->vol[out][in] *= op->vol;
+                }
+            }
+            break;
+
+        case MIX_UPMIX:
+            memmove(mtx->vol[op->ch_dst + 1], mtx->vol[op->ch_dst], (channels - op->ch_dst) * row_size);
+            memset(mtx->vol[op->ch_dst], 0, row_size);
+            mtx->output_channels += 1;
+            break;
+
+        case MIX_DOWNMIX:
+            memmove(mtx->vol[op->ch_dst], mtx->vol[op->ch_dst + 1], (channels - op->ch_dst - 1) * row_size);
+            memset(mtx->vol[channels - 1], 0, row_size);
+            mtx->output_channels -= 1;
+            break;
+
+        case MIX_KILLMIX:
+            memset(mtx->vol[op->ch_dst], 0, (channels - op->ch_dst) * row_size);
+            mtx->output_channels = op->ch_dst;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* returns Q15 volume, or a value over MIX_Q15_MAX if it can't be used */
+static int32_t get_qvol(double vol) {
+    if (vol <= -2.0 || vol >= 2.0)
+        return MIX_Q15_MAX + 1;
+    return (int32_t)lround(vol * 32768.0);
+}
+
+static bool is_op_linear(mix_op_t* op) {
+    return op->type != MIX_FADE && op->type != MIX_LIMIT;
+}
+
+static mix_stage_t* add_stage(mixer_t* mixer) {
+    mix_stage_t* stages = realloc(mixer->stages, (mixer->stages_count + 1) * sizeof(mix_stage_t));
+    if (!stages) return NULL;
+    mixer->stages = stages;
+
+    mix_stage_t* stage = &mixer->stages[mixer->stages_count];
+    memset(stage, 0, sizeof(mix_stage_t));
+    mixer->stages_count++;
+    return stage;
+}
+
+/* saves current matrix as a stage with only non-zero terms */
+static bool add_matrix_stage(mixer_t* mixer, mix_matrix_t* mtx) {
+    if (matrix_is_identity(mtx))
+        return true;
+
+    mix_stage_t* stage = add_stage(mixer);
+    if (!stage) return false;
+
+    stage->input_channels = mtx->input_channels;
+    stage->output_channels = mtx->output_channels;
+
+    double vol = matrix_get_volume(mtx);
+    if (vol != 0.0) {
+        stage->is_volume = true;
+        stage->vol = vol;
+        stage->qvol = get_qvol(vol);
+        stage->is_fixed = abs(stage->qvol) <= MIX_Q15_MAX;
+        return true;
+    }
+
+    stage->out_terms = calloc(mtx->output_channels, sizeof(int));
+    stage->terms = calloc(mtx->output_channels * mtx->input_channels, sizeof(mix_term_t));
+    if (!stage->out_terms || !stage->terms) return false;
+
+    int count = 0;
+    stage->is_fixed = true;
+    for (int out = 0; out < mtx->output_channels; out++) {
+        int32_t qvol_sum = 0;
+        for (int in = 0; in < mtx->input_channels; in++) {
+            if (mtx->vol[out][in] == 0.0)
+                continue;
+            stage->terms[count].ch_src = in;
+            stage->terms[count].vol = mtx->vol[out][in];
+            stage->terms[count].qvol = get_qvol(mtx->vol[out][in]);
+            stage->out_terms[out]++;
+
+            qvol_sum += abs(stage->terms[count].qvol);
+            if (qvol_sum > MIX_Q15_MAX)
+                stage->is_fixed = false;
+            count++;
+        }
+    }
+
+    return true;
+}
+
+void mixer_compile_chain(mixer_t* mixer) {
+    mix_matrix_t* mtx = NULL;
+
+    mixer_free_stages(mixer);
+    if (mixer->chain_count <= 0)
+        return;
+
+    mtx = malloc(sizeof(mix_matrix_t));
+    if (!mtx) goto fail;
+
+    matrix_reset(mtx, mixer->input_channels);
+    for (int m = 0; m < mixer->chain_count; m++) {
+        mix_op_t* op = &mixer->chain[m];
+
+        if (is_op_linear(op)) {
+            matrix_apply_op(mtx, op);
+            continue;
+        }
+
+        /* non-linear ops split matrices */
+        if (!add_matrix_stage(mixer, mtx))
+            goto fail;
+
+        mix_stage_t* stage = add_stage(mixer);
+        if (!stage) goto fail;
+        stage->op = op;
+        stage->input_channels = mtx->output_channels;
+        stage->output_channels = mtx->output_channels;
+
+        matrix_reset(mtx, mtx->output_channels);
+    }
+
+    if (!add_matrix_stage(mixer, mtx))
+        goto fail;
+
+    mixer->compiled = true;
+    mixer->is_fixed_s16 = mixer->stages_count == 0 ||
+        (mixer->stages_count == 1 && !mixer->stages[0].op && mixer->stages[0].is_fixed);
+    free(mtx);
+    return;
+fail:
+    /* ops will be applied one by one */
+    free(mtx);
+    mixer_free_stages(mixer);
+}
+
+void mixer_free_stages(mixer_t* mixer) {
+    for (int i = 0; i < mixer->stages_count; i++) {
+        free(mixer->stages[i].out_terms);
+        free(mixer->stages[i].terms);
+    }
+    free(mixer->stages);
+    mixer->stages = NULL;
+    mixer->stages_count = 0;
+    mixer->compiled = false;
+    mixer->is_fixed_s16 = false;
+}
+
+
+static inline void mix_sample(float* dst, const float* src, mix_stage_t* stage) {
+    mix_term_t* term = stage->terms;
+
+    for (int out = 0; out < stage->output_channels; out++) {
+        int count = stage->out_terms[out];
+        float sample = 0.0f;
+
+        if (count > 0) {
+            sample = src[term[0].ch_src] * term[0].vol;
+            for (int t = 1; t < count; t++) {
+                sample += src[term[t].ch_src] * term[t].vol;
+            }
+        }
+
+        dst[out] = sample;
+        term += count;
+    }
+}
+
+void mixer_op_matrix(mixer_t* mixer, int32_t sample_count, mix_stage_t* stage) {
+    float temp[VGMSTREAM_MAX_CHANNELS];
+    int input_channels = stage->input_channels;
+    int output_channels = stage->output_channels;
+
+    mixer->current_channels = output_channels;
+
+    if (stage->is_volume) {
+        samples_f32_scale(mixer->mixbuf, mixer->mixbuf, sample_count * output_channels, stage->vol);
+        return;
+    }
+
+    /* mixbuf is modified in place, so when adding channels go backwards as otherwise would
+     * overwrite samples before reading them (each sample's input is copied first) */
+    if (output_channels > input_channels) {
+        for (int s = sample_count - 1; s >= 0; s--) {
+            memcpy(temp, mixer->mixbuf + s * input_channels, input_channels * sizeof(float));
+            mix_sample(mixer->mixbuf + s * output_channels, temp, stage);
+        }
+    }
+    else {
+        for (int s = 0; s < sample_count; s++) {
+            memcpy(temp, mixer->mixbuf + s * input_channels, input_channels * sizeof(float));
+            mix_sample(mixer->mixbuf + s * output_channels, temp, stage);
+        }
+    }
+}
+
+
+/* rounds towards zero like float mixing's conversion to s16 */
+static inline int16_t q15_to_s16(int32_t acc) {
+    if (acc < 0)
+        acc += 0x7FFF;
+    acc >>= 15;
+    if (acc > 32767) return 32767;
+    if (acc < -32768) return -32768;
+    return (int16_t)acc;
+}
+
+static inline void mix_sample_s16(int16_t* dst, const int16_t* src, mix_stage_t* stage) {
+    mix_term_t* term = stage->terms;
+
+    for (int out = 0; out < stage->output_channels; out++) {
+        int count = stage->out_terms[out];
+        int32_t acc = 0;
+
+        for (int t = 0; t < count; t++) {
+            acc += src[term[t].ch_src] * term[t].qvol;
+        }
+
+        dst[out] = q15_to_s16(acc);
+        term += count;
+    }
+}
+
+/* same as mixer_op_matrix but directly over a s16 sbuf (chain must be is_fixed_s16) */
+void mixer_op_matrix_s16(mixer_t* mixer, sbuf_t* sbuf) {
+    int16_t temp[VGMSTREAM_MAX_CHANNELS];
+    int16_t* buf = sbuf->buf;
+    int sample_count = sbuf->filled;
+
+    if (mixer->stages_count == 0)
+        return;
+
+    mix_stage_t* stage = &mixer->stages[0];
+    int input_channels = stage->input_channels;
+    int output_channels = stage->output_channels;
+
+    if (stage->is_volume) {
+        int32_t qvol = stage->qvol;
+        int count = sample_count * output_channels;
+        for (int i = 0; i < count; i++) {
+            buf[i] = q15_to_s16(buf[i] * qvol);
+        }
+        return;
+    }
+
+    if (output_channels > input_channels) {
+        for (int s = sample_count - 1; s >= 0; s--) {
+            memcpy(temp, buf + s * input_channels, input_channels * sizeof(int16_t));
+            mix_sample_s16(buf + s * output_channels, temp, stage);
+        }
+    }
+    else {
+        for (int s = 0; s < sample_count; s++) {
+            memcpy(temp, buf + s * input_channels, input_channels * sizeof(int16_t));
+            mix_sample_s16(buf + s * output_channels, temp, stage);
+        }
+    }
+}
@@ -34,6 +34,28 @@ typedef struct {
     int32_t time_post;  /* position after time_end where vol_end applies (-1 = end) */
 } mix_op_t;
 
+typedef struct {
+    int ch_src;
+    float vol;
+    int32_t qvol;           /* vol in Q15 fixed point */
+} mix_term_t;
+
+/* compiled chain part: a non-linear op, or combined linear ops as a matrix */
+typedef struct {
+    mix_op_t* op;           /* applied as-is if set (fades, limits) */
+    int input_channels;
+    int output_channels;
+
+    bool is_volume;         /* only volume for all channels */
+    float vol;
+    int32_t qvol;
+
+    bool is_fixed;          /* volumes can be applied in Q15 to s16 samples without overflow */
+
+    int* out_terms;         /* number of terms per output channel */
+    mix_term_t* terms;      /* non-zero input channels * volume, in output channel order */
+} mix_stage_t;
+
 struct mixer_t {
     int input_channels;     /* starting channels before mixing */
     int output_channels;    /* resulting channels after mixing */
@@ -49,6 +71,12 @@ struct mixer_t {
     bool has_non_fade;
     bool has_fade;
 
+    /* chain converted to fewer passes on setup (if not set ops are applied one by one) */
+    bool compiled;
+    mix_stage_t* stages;
+    int stages_count;
+    bool is_fixed_s16;      /* whole chain is a single fixed point matrix (s16 input can skip mixbuf) */
+
     float* mixbuf;          /* internal mixing buffer */
     int current_channels;   /* state: channels may increase/decrease during ops */
     int32_t current_subpos; /* state: current sample pos in the stream */
@@ -65,4 +93,9 @@ void mixer_op_downmix(mixer_t* mixer, int32_t sample_count, mix_op_t* op);
 void mixer_op_killmix(mixer_t* mixer, int32_t sample_count, mix_op_t* op);
 void mixer_op_fade(mixer_t* mixer, int32_t sample_count, mix_op_t* op);
 bool mixer_op_fade_is_active(mixer_t* mixer, int32_t current_start, int32_t current_end);
+
+void mixer_compile_chain(mixer_t* mixer);
+void mixer_free_stages(mixer_t* mixer);
+void mixer_op_matrix(mixer_t* mixer, int32_t sample_count, mix_stage_t* stage);
+void mixer_op_matrix_s16(mixer_t* mixer, sbuf_t* sbuf);
 #endif
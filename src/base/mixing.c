@@ -110,6 +110,9 @@ void mixing_setup(VGMSTREAM* vgmstream, int32_t max_sample_count) {
     mixer->mixbuf = mixbuf_re;
     mixer->active = true;
 
+    /* ops can't change once active */
+    mixer_compile_chain(mixer);
+
     fix_channel_layout(vgmstream);
 
     /* since data exists on its own memory and pointer is already set
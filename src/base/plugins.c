@@ -2,6 +2,9 @@
 #include "../util/log.h"
 #include "plugins.h"
 #include "mixing.h"
+#include "decode_parallel.h"
+#include "seek_index.h"
+#include "../util/threads.h"
 
 
 /* ****************************************** */
@@ -195,6 +198,29 @@ void vgmstream_mixing_stereo_only(VGMSTREAM* vgmstream, int start) {
 }
 
 
+/* ****************************************** */
+/* THREADS: multithreaded decoding            */
+/* ****************************************** */
+
+bool vgmstream_set_decode_threads(VGMSTREAM* vgmstream, int threads, int modes) {
+    if (!vgmstream)
+        return false;
+
+    if (threads < 0)
+        threads = vgm_threads_get_cpus();
+    return decode_parallel_enable(vgmstream, threads, modes);
+}
+
+
+/* ****************************************** */
+/* SEEK: seek helpers                         */
+/* ****************************************** */
+
+bool vgmstream_set_seek_index(VGMSTREAM* vgmstream, bool enable) {
+    return seek_index_enable(vgmstream, enable);
+}
+
+
 /* ****************************************** */
 /* LOG: log                                   */
 /* ****************************************** */
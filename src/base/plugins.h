@@ -57,6 +57,17 @@ void vgmstream_apply_config(VGMSTREAM* vgmstream, vgmstream_cfg_t* pcfg);
 int32_t vgmstream_get_samples(VGMSTREAM* vgmstream);
 int vgmstream_get_play_forever(VGMSTREAM* vgmstream);
 void vgmstream_set_play_forever(VGMSTREAM* vgmstream, int enabled);
+enum {
+    VGM_THREADS_CHANNELS = 0x01,    /* channel groups of simple codecs */
+    VGM_THREADS_LAYERS = 0x02,      /* layers of layered layouts */
+    VGM_THREADS_SEGMENTS = 0x04,    /* prefetch of next segment in segmented layouts */
+    VGM_THREADS_ALL = 0xFF,
+};
+/* decodes in parallel with N threads (-1: all CPUs, 0/1: disabled) using VGM_THREADS_* modes; call before decoding */
+bool vgmstream_set_decode_threads(VGMSTREAM* vgmstream, int threads, int modes);
+
+/* saves decoder state while decoding so seeking back is faster (uses some memory); call before decoding */
+bool vgmstream_set_seek_index(VGMSTREAM* vgmstream, bool enable);
 
 
 typedef struct {
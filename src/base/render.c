@@ -3,6 +3,8 @@
 #include "render.h"
 #include "decode.h"
 #include "mixing.h"
+#include "decode_parallel.h"
+#include "seek_index.h"
 
 
 /* VGMSTREAM RENDERING
@@ -146,6 +148,15 @@ int render_layout(sbuf_t* sbuf, VGMSTREAM* vgmstream) {
             break;
     }
 
+    // layouts may have queued frames
+    if (vgmstream->parallel_data) {
+        decode_parallel_flush(vgmstream);
+    }
+
+    if (vgmstream->seek_index) {
+        seek_index_record(vgmstream);
+    }
+
     // decode past stream samples: blank rest of buf
     if (vgmstream->current_sample > vgmstream->num_samples) {
         int32_t excess, decoded;
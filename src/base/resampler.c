@@ -0,0 +1,334 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../util/samples_ops.h"
+#include "resampler.h"
+
+/* RESAMPLER
+ * Polyphase windowed-sinc (Kaiser) FIR. Rates are reduced to up/down (ex. 44100 > 48000 = 147 > 160), so output
+ * sample N is at input position N * down / up, and the fractional part picks one of 'up' precalculated filter
+ * phases (quantized if there are too many, meaning a tiny timing error). Each output sample is then a dot product
+ * of that phase's coefs with the input history around the position, per channel.
+ *
+ * When downsampling the cutoff is lowered to the output's nyquist (with more taps to keep the same transition
+ * band), otherwise to the input's. Each phase is normalized to unity gain, so DC/silence stays exact.
+ *
+ * Input is kept as planar floats (in the original scale, so s16 = +-32768) with enough history to
+ * compute the next output sample; positions are absolute so seeking is just a reset.
+ */
+
+#define RESAMPLER_PI 3.14159265358979323846
+#define RESAMPLER_MAX_PHASES 1024
+#define RESAMPLER_MAX_TAPS 256
+#define RESAMPLER_FEED_MAX 4096     /* max input samples buffered at once (besides history) */
+#define RESAMPLER_CHUNK 256         /* output samples calculated before converting */
+
+struct resampler_t {
+    int channels;
+    int up;                 /* reduced output rate */
+    int down;               /* reduced input rate */
+
+    /* filter */
+    int taps;
+    int phases;
+    float* coefs;           /* [phases][taps] */
+
+    /* input history */
+    float* hist;            /* [channels][hist_size] */
+    int hist_size;
+    int hist_count;
+    int64_t hist_start;     /* absolute input position of hist[][0] */
+
+    /* output state */
+    int64_t base;           /* input position of current output sample (integer part) */
+    int frac;               /* fractional part (in 1/up units) */
+
+    float* outbuf;          /* [RESAMPLER_CHUNK][channels] */
+};
+
+
+static int get_gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* modified Bessel function of the first kind (order 0), for Kaiser windows */
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+static bool init_filter(resampler_t* rs, resampler_quality_t quality) {
+    int taps;
+    double beta, rolloff;
+
+    switch(quality) {
+        case RESAMPLER_QUALITY_FAST:    taps = 16; beta = 6.0;  rolloff = 0.85; break;
+        case RESAMPLER_QUALITY_BEST:    taps = 64; beta = 10.0; rolloff = 0.95; break;
+        case RESAMPLER_QUALITY_MEDIUM:
+        default:                        taps = 32; beta = 8.0;  rolloff = 0.91; break;
+    }
+
+    double cutoff = rolloff;
+    if (rs->down > rs->up) {
+        cutoff = rolloff * rs->up / rs->down;
+        taps = (int)ceil((double)taps * rs->down / rs->up);
+    }
+    taps = (taps + 3) & ~3; /* multiple of 4 for SIMD */
+    if (taps > RESAMPLER_MAX_TAPS)
+        taps = RESAMPLER_MAX_TAPS;
+
+    rs->taps = taps;
+    rs->phases = rs->up <= RESAMPLER_MAX_PHASES ? rs->up : RESAMPLER_MAX_PHASES;
+    rs->coefs = malloc(rs->phases * taps * sizeof(float));
+    if (!rs->coefs) return false;
+
+    int half = taps / 2;
+    double i0_beta = bessel_i0(beta);
+    for (int p = 0; p < rs->phases; p++) {
+        float* coef = &rs->coefs[p * taps];
+        double frac = (double)p / rs->phases;
+        double sum = 0.0;
+
+        /* coef k applies to input (base - half + 1 + k), at distance (frac + half - 1 - k) from output position */
+        for (int k = 0; k < taps; k++) {
+            double dist = frac + half - 1 - k;
+            double x = dist * cutoff;
+            double sinc = (x == 0.0) ? 1.0 : sin(RESAMPLER_PI * x) / (RESAMPLER_PI * x);
+            double w = dist / half;
+            double window = (w <= -1.0 || w >= 1.0) ? 0.0 : bessel_i0(beta * sqrt(1.0 - w * w)) / i0_beta;
+
+            coef[k] = (float)(sinc * window);
+            sum += coef[k];
+        }
+
+        for (int k = 0; k < taps; k++) {
+            coef[k] = (float)(coef[k] / sum);
+        }
+    }
+
+    return true;
+}
+
+resampler_t* resampler_init(int channels, int input_rate, int output_rate, resampler_quality_t quality) {
+    resampler_t* rs = NULL;
+
+    if (channels <= 0 || input_rate <= 0 || output_rate <= 0)
+        return NULL;
+
+    rs = calloc(1, sizeof(resampler_t));
+    if (!rs) goto fail;
+
+    int gcd = get_gcd(input_rate, output_rate);
+    rs->channels = channels;
+    rs->up = output_rate / gcd;
+    rs->down = input_rate / gcd;
+
+    if (!init_filter(rs, quality))
+        goto fail;
+
+    rs->hist_size = rs->taps + RESAMPLER_FEED_MAX;
+    rs->hist = malloc(rs->hist_size * channels * sizeof(float));
+    if (!rs->hist) goto fail;
+
+    rs->outbuf = malloc(RESAMPLER_CHUNK * channels * sizeof(float));
+    if (!rs->outbuf) goto fail;
+
+    resampler_reset(rs, 0, 0);
+    return rs;
+fail:
+    resampler_free(rs);
+    return NULL;
+}
+
+void resampler_free(resampler_t* rs) {
+    if (!rs) return;
+
+    free(rs->coefs);
+    free(rs->hist);
+    free(rs->outbuf);
+    free(rs);
+}
+
+
+static inline int64_t get_first_pos(resampler_t* rs) {
+    return rs->base - rs->taps / 2 + 1;
+}
+
+int64_t resampler_get_input_pos(resampler_t* rs, int64_t output_pos) {
+    return output_pos * rs->down / rs->up - rs->taps / 2 + 1;
+}
+
+int64_t resampler_get_output_samples(resampler_t* rs, int64_t input_samples) {
+    return (input_samples * rs->up + rs->down - 1) / rs->down;
+}
+
+void resampler_reset(resampler_t* rs, int64_t output_pos, int64_t input_pos) {
+    rs->base = output_pos * rs->down / rs->up;
+    rs->frac = (int)(output_pos * rs->down % rs->up);
+
+    int64_t first = get_first_pos(rs);
+    if (input_pos > first) {
+        /* missing history (like at the beginning) */
+        int64_t zeros = input_pos - first;
+        if (zeros > rs->hist_size)
+            zeros = rs->hist_size;
+        for (int ch = 0; ch < rs->channels; ch++) {
+            memset(rs->hist + ch * rs->hist_size, 0, zeros * sizeof(float));
+        }
+        rs->hist_start = input_pos - zeros;
+        rs->hist_count = (int)zeros;
+    }
+    else {
+        rs->hist_start = input_pos;
+        rs->hist_count = 0;
+    }
+}
+
+/* removes history not needed by current output position */
+static void compact_hist(resampler_t* rs) {
+    int64_t first = get_first_pos(rs);
+    if (first <= rs->hist_start || rs->hist_count == 0)
+        return;
+
+    int drop = rs->hist_count;
+    if (first - rs->hist_start < drop)
+        drop = (int)(first - rs->hist_start);
+
+    int keep = rs->hist_count - drop;
+    if (keep > 0) {
+        for (int ch = 0; ch < rs->channels; ch++) {
+            float* hist = rs->hist + ch * rs->hist_size;
+            memmove(hist, hist + drop, keep * sizeof(float));
+        }
+    }
+    rs->hist_start += drop;
+    rs->hist_count = keep;
+}
+
+int resampler_feed(resampler_t* rs, sbuf_t* sbuf) {
+    int channels = rs->channels;
+    int available = sbuf->filled;
+    int consumed = 0;
+
+    compact_hist(rs);
+
+    /* input before what current position needs (after seeking or when downsampling) */
+    int64_t first = get_first_pos(rs);
+    if (rs->hist_count == 0 && rs->hist_start < first) {
+        int skip = available;
+        if (skip > first - rs->hist_start)
+            skip = (int)(first - rs->hist_start);
+        consumed += skip;
+        rs->hist_start += skip;
+    }
+
+    int to_do = available - consumed;
+    if (to_do > rs->hist_size - rs->hist_count)
+        to_do = rs->hist_size - rs->hist_count;
+    if (to_do <= 0)
+        return consumed;
+
+    for (int ch = 0; ch < channels; ch++) {
+        float* hist = rs->hist + ch * rs->hist_size + rs->hist_count;
+
+        switch(sbuf->fmt) {
+            case SFMT_S16: {
+                int16_t* src = (int16_t*)sbuf->buf + consumed * channels + ch;
+                for (int s = 0; s < to_do; s++) {
+                    hist[s] = src[s * channels];
+                }
+                break;
+            }
+            case SFMT_F32:
+            case SFMT_FLT: {
+                float* src = (float*)sbuf->buf + consumed * channels + ch;
+                for (int s = 0; s < to_do; s++) {
+                    hist[s] = src[s * channels];
+                }
+                break;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    rs->hist_count += to_do;
+    return consumed + to_do;
+}
+
+void resampler_feed_silence(resampler_t* rs) {
+    compact_hist(rs);
+
+    int to_do = rs->hist_size - rs->hist_count;
+    if (to_do > rs->taps)
+        to_do = rs->taps;
+
+    for (int ch = 0; ch < rs->channels; ch++) {
+        memset(rs->hist + ch * rs->hist_size + rs->hist_count, 0, to_do * sizeof(float));
+    }
+    rs->hist_count += to_do;
+}
+
+int resampler_render(resampler_t* rs, sbuf_t* sbuf) {
+    int channels = rs->channels;
+    int taps = rs->taps;
+    int done = 0;
+
+    while (sbuf->filled < sbuf->samples) {
+        int max = sbuf->samples - sbuf->filled;
+        if (max > RESAMPLER_CHUNK)
+            max = RESAMPLER_CHUNK;
+
+        int count = 0;
+        while (count < max) {
+            int64_t first = get_first_pos(rs);
+            if (first < rs->hist_start || first + taps > rs->hist_start + rs->hist_count)
+                break; /* needs more input */
+
+            int phase = rs->phases == rs->up ? rs->frac : (int)((int64_t)rs->frac * rs->phases / rs->up);
+            const float* coef = &rs->coefs[phase * taps];
+            const float* hist = rs->hist + (first - rs->hist_start);
+            float* out = rs->outbuf + count * channels;
+
+            for (int ch = 0; ch < channels; ch++) {
+                out[ch] = samples_f32_dot(coef, hist + ch * rs->hist_size, taps);
+            }
+
+            rs->frac += rs->down;
+            rs->base += rs->frac / rs->up;
+            rs->frac %= rs->up;
+            count++;
+        }
+
+        if (count == 0)
+            break;
+
+        switch(sbuf->fmt) {
+            case SFMT_S16:
+                samples_f32_to_s16_trunc((int16_t*)sbuf->buf + sbuf->filled * channels, rs->outbuf, count * channels, 1.0f);
+                break;
+            case SFMT_F32:
+            case SFMT_FLT:
+                memcpy((float*)sbuf->buf + sbuf->filled * channels, rs->outbuf, count * channels * sizeof(float));
+                break;
+            default:
+                return done;
+        }
+
+        sbuf->filled += count;
+        done += count;
+    }
+
+    return done;
+}
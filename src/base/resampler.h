@@ -0,0 +1,40 @@
+#ifndef _RESAMPLER_H
+#define _RESAMPLER_H
+
+#include "../streamtypes.h"
+#include "sbuf.h"
+
+typedef enum {
+    RESAMPLER_QUALITY_FAST = 1,
+    RESAMPLER_QUALITY_MEDIUM = 2,
+    RESAMPLER_QUALITY_BEST = 3,
+} resampler_quality_t;
+
+typedef struct resampler_t resampler_t;
+
+/* Streaming resampler that converts interleaved samples between rates. Positions are absolute sample indexes
+ * (input and output), so seeking just needs a reset to the new output position. Returns NULL if not possible. */
+resampler_t* resampler_init(int channels, int input_rate, int output_rate, resampler_quality_t quality);
+
+void resampler_free(resampler_t* rs);
+
+/* Prepares to output from out_pos, with next input fed being input_pos (must be <= resampler_get_input_pos,
+ * extra samples are skipped; if greater, samples before are treated as silence). */
+void resampler_reset(resampler_t* rs, int64_t output_pos, int64_t input_pos);
+
+/* First input sample needed to render output_pos. */
+int64_t resampler_get_input_pos(resampler_t* rs, int64_t output_pos);
+
+/* Output samples for a given number of input samples. */
+int64_t resampler_get_output_samples(resampler_t* rs, int64_t input_samples);
+
+/* Adds sbuf's filled samples (S16/F32/FLT), returns consumed samples (may be less if internal buf is full). */
+int resampler_feed(resampler_t* rs, sbuf_t* sbuf);
+
+/* Adds silence (for flushing once input is done). */
+void resampler_feed_silence(resampler_t* rs);
+
+/* Renders into sbuf as many samples as possible (until full or more input is needed), returns rendered samples. */
+int resampler_render(resampler_t* rs, sbuf_t* sbuf);
+
+#endif
@@ -2,6 +2,7 @@
 #include <string.h>
 //#include <math.h>
 #include "../util.h"
+#include "../util/samples_ops.h"
 #include "sbuf.h"
 
 
@@ -106,58 +107,56 @@ static inline float double_to_float(double val) {
 //TODO decide if using float 1.0 style or 32767 style (fuzzy PCM when doing that)
 //TODO: maybe use macro-style templating (but kinda ugly)
 void sbuf_copy_to_f32(float* dst, sbuf_t* sbuf) {
+    int count = sbuf->filled * sbuf->channels;
 
     switch(sbuf->fmt) {
-        case SFMT_S16: {
-            int16_t* src = sbuf->buf;
-            for (int s = 0; s < sbuf->filled * sbuf->channels; s++) {
-                dst[s] = (float)src[s]; // / 32767.0f
-            }
+        case SFMT_S16:
+            samples_s16_to_f32(dst, sbuf->buf, count); // / 32767.0f
             break;
-        }
 
         case SFMT_FLT:
-        case SFMT_F32: {
-            float* src = sbuf->buf;
-            for (int s = 0; s < sbuf->filled * sbuf->channels; s++) {
-                dst[s] = src[s];
-            }
+        case SFMT_F32:
+            memcpy(dst, sbuf->buf, count * sizeof(float));
             break;
-        }
         default:
             break;
     }
 }
 
+/* conversions with float_to_int use samples_ops' _trunc kernels, that give the same results */
 void sbuf_copy_from_f32(sbuf_t* sbuf, float* src) {
+    int count = sbuf->filled * sbuf->channels;
+
     switch(sbuf->fmt) {
-        case SFMT_S16: {
-            int16_t* dst = sbuf->buf;
-            for (int s = 0; s < sbuf->filled * sbuf->channels; s++) {
-                dst[s] = clamp16(float_to_int(src[s]));
-            }
+        case SFMT_S16:
+            samples_f32_to_s16_trunc(sbuf->buf, src, count, 1.0f);
             break;
-        }
-        case SFMT_F32: {
-            float* dst = sbuf->buf;
-            for (int s = 0; s < sbuf->filled * sbuf->channels; s++) {
-                dst[s] = src[s];
-            }
+        case SFMT_F32:
+            memcpy(sbuf->buf, src, count * sizeof(float));
             break;
-        }
-        case SFMT_FLT: {
-            float* dst = sbuf->buf;
-            for (int s = 0; s < sbuf->filled * sbuf->channels; s++) {
-                dst[s] = src[s] / 32768.0f;
-            }
+        case SFMT_FLT:
+            samples_f32_scale(sbuf->buf, src, count, 1.0f / 32768.0f); /* same as dividing (power of 2) */
             break;
-        }
         default:
             break;
     }
 }
 
 
+void sbuf_copy_to_planar(void** dst, int skip, sbuf_t* sbuf) {
+    switch(sbuf->fmt) {
+        case SFMT_S16:
+            samples_s16_to_s16p((int16_t**)dst, sbuf->buf, sbuf->channels, skip, sbuf->filled);
+            break;
+        case SFMT_F32:
+        case SFMT_FLT:
+            samples_f32_to_f32p((float**)dst, sbuf->buf, sbuf->channels, skip, sbuf->filled);
+            break;
+        default:
+            break;
+    }
+}
+
 int sbuf_get_copy_max(sbuf_t* sdst, sbuf_t* ssrc) {
     int samples_copy = ssrc->filled;
     if (samples_copy > sdst->samples - sdst->filled)
@@ -166,16 +165,6 @@ int sbuf_get_copy_max(sbuf_t* sdst, sbuf_t* ssrc) {
 }
 
 /* ugly thing to avoid repeating functions */
-#define sbuf_copy_segments_internal(dst, src, src_pos, dst_pos, src_max) \
-    while (src_pos < src_max) { \
-        dst[dst_pos++] = src[src_pos++]; \
-    }
-
-#define sbuf_copy_segments_internal_s16(dst, src, src_pos, dst_pos, src_max, value) \
-    while (src_pos < src_max) { \
-        dst[dst_pos++] = clamp16(float_to_int(src[src_pos++] * value)); \
-    }
-
 #define sbuf_copy_segments_internal_flt(dst, src, src_pos, dst_pos, src_max, value) \
     while (src_pos < src_max) { \
         dst[dst_pos++] = float_to_int(src[src_pos++] * value); \
@@ -206,29 +195,24 @@ void sbuf_copy_segments(sbuf_t* sdst, sbuf_t* ssrc) {
 
     if (sdst->fmt == SFMT_S16 && ssrc->fmt == SFMT_S16) {
         int16_t* dst = sdst->buf;
-        int16_t* src = ssrc->buf;
-        sbuf_copy_segments_internal(dst, src, src_pos, dst_pos, src_max);
+        memcpy(dst + dst_pos, ssrc->buf, src_max * sizeof(int16_t));
     }
     else if (sdst->fmt == SFMT_F32 && ssrc->fmt == SFMT_S16) {
         float* dst = sdst->buf;
-        int16_t* src = ssrc->buf;
-        sbuf_copy_segments_internal(dst, src, src_pos, dst_pos, src_max);
+        samples_s16_to_f32(dst + dst_pos, ssrc->buf, src_max);
     }
     else if ((sdst->fmt == SFMT_F32 && ssrc->fmt == SFMT_F32) || (sdst->fmt == SFMT_FLT && ssrc->fmt == SFMT_FLT)) {
         float* dst = sdst->buf;
-        float* src = ssrc->buf;
-        sbuf_copy_segments_internal(dst, src, src_pos, dst_pos, src_max);
+        memcpy(dst + dst_pos, ssrc->buf, src_max * sizeof(float));
     }
     // to s16
     else if (sdst->fmt == SFMT_S16 && ssrc->fmt == SFMT_F32) {
         int16_t* dst = sdst->buf;
-        float* src = ssrc->buf;
-        sbuf_copy_segments_internal_s16(dst, src, src_pos, dst_pos, src_max, 1.0f);
+        samples_f32_to_s16_trunc(dst + dst_pos, ssrc->buf, src_max, 1.0f);
     }
     else if (sdst->fmt == SFMT_S16 && ssrc->fmt == SFMT_FLT) {
         int16_t* dst = sdst->buf;
-        float* src = ssrc->buf;
-        sbuf_copy_segments_internal_s16(dst, src, src_pos, dst_pos, src_max, 32768.0f);
+        samples_f32_to_s16_trunc(dst + dst_pos, ssrc->buf, src_max, 32768.0f);
     }
     // to f32
     else if (sdst->fmt == SFMT_F32 && ssrc->fmt == SFMT_FLT) {
@@ -315,7 +299,16 @@ void sbuf_copy_layers(sbuf_t* sdst, sbuf_t* ssrc, int dst_ch_start, int dst_expe
     if (sdst->fmt == SFMT_S16 && ssrc->fmt == SFMT_S16) {
         int16_t* dst = sdst->buf;
         int16_t* src = ssrc->buf;
-        sbuf_copy_layers_internal(dst, src, src_pos, dst_pos, src_filled, dst_expected, src_channels, dst_ch_step);
+        /* usual layers, constant channels so inner loops unroll */
+        if (src_channels == 1) {
+            sbuf_copy_layers_internal(dst, src, src_pos, dst_pos, src_filled, dst_expected, 1, dst_ch_step);
+        }
+        else if (src_channels == 2) {
+            sbuf_copy_layers_internal(dst, src, src_pos, dst_pos, src_filled, dst_expected, 2, dst_ch_step);
+        }
+        else {
+            sbuf_copy_layers_internal(dst, src, src_pos, dst_pos, src_filled, dst_expected, src_channels, dst_ch_step);
+        }
     }
     else if (sdst->fmt == SFMT_F32 && ssrc->fmt == SFMT_S16) {
         float* dst = sdst->buf;
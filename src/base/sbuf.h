@@ -4,7 +4,8 @@
 #include "../streamtypes.h"
 
 /* All types are interleaved (buffer for all channels = [ch*s] = ch1 ch2 ch1 ch2 ch1 ch2 ...)
- * rather than planar (buffer per channel = [ch][s] = c1 c1 c1 c1 ...  c2 c2 c2 c2 ...) */
+ * rather than planar (buffer per channel = [ch][s] = c1 c1 c1 c1 ...  c2 c2 c2 c2 ...).
+ * Planar is only used for final output (see sbuf_copy_to_planar). */
 typedef enum {
     SFMT_NONE,
     SFMT_S16,           /* standard PCM16 */
@@ -43,6 +44,8 @@ void sbuf_copy_to_f32(float* dst, sbuf_t* sbuf);
 void sbuf_copy_from_f32(sbuf_t* sbuf, float* src);
 void sbuf_copy_segments(sbuf_t* sdst, sbuf_t* ssrc);
 void sbuf_copy_layers(sbuf_t* sdst, sbuf_t* ssrc, int dst_ch_start, int expected);
+/* copies filled samples into per-channel bufs, starting from sample 'skip' in each */
+void sbuf_copy_to_planar(void** dst, int skip, sbuf_t* sbuf);
 
 void sbuf_silence_s16(sample_t* dst, int samples, int channels, int filled);
 void sbuf_silence_rest(sbuf_t* sbuf);
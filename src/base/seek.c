@@ -5,6 +5,7 @@
 #include "mixing.h"
 #include "plugins.h"
 #include "sbuf.h"
+#include "seek_index.h"
 
 /* pretend decoder reached loop end so internal state is set like jumping to loop start 
  * (no effect in some layouts but that is ok) */
@@ -25,6 +26,14 @@ static void seek_force_decode(VGMSTREAM* vgmstream, int samples) {
     sbuf_t sbuf_tmp;
     sbuf_init(&sbuf_tmp, mixing_get_input_sample_type(vgmstream), tmpbuf, buf_samples, vgmstream->channels);
 
+    /* jump to the nearest saved state if possible */
+    if (vgmstream->seek_index) {
+        samples -= seek_index_restore(vgmstream, samples);
+    }
+    else {
+        samples -= decode_skip(vgmstream, samples);
+    }
+
     while (samples) {
         int to_do = samples;
         if (to_do > buf_samples)
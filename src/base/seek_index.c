@@ -0,0 +1,478 @@
+#include "../vgmstream.h"
+#include "../layout/layout.h"
+#include "decode.h"
+#include "decode_parallel.h"
+#include "seek_index.h"
+
+
+/* SEEK INDEX
+ * Seeking backwards means reset + decoding (and discarding) everything up to the seek point, which gets slow
+ * with long songs. Simple codecs keep all decoder state in the VGMSTREAM (layout/block state) and channels
+ * (offsets, ADPCM history), so copying those every N samples while decoding gives points that seeks can
+ * jump to, then decode just the remainder.
+ *
+ * Checkpoints are only saved in increasing order (positions are the same after looping) and must be valid
+ * for any loop pass, so:
+ * - checkpoints past loop end can't be used while looping (decoder must loop there)
+ * - codecs that keep loop end's ADPCM history when looping only save up to loop start
+ *
+ * Blocked layouts can only find block N by reading all block headers before it. Instead of full copies
+ * they save a small point per block (offset + values block_update may need + ADPCM history) right before
+ * moving to a new block, then seeks call block_update with it like the layout would. This uses less memory
+ * per point so there can be one every block, and seeks decode at most one block.
+ */
+
+#define SEEK_INDEX_MIN_INTERVAL 4096
+#define SEEK_INDEX_MIN_BLOCK_INTERVAL 1024
+
+typedef struct {
+    int32_t current_sample;
+    int32_t samples_into_block;
+    off_t current_block_offset;
+    size_t current_block_size;
+    int32_t current_block_samples;
+    off_t next_block_offset;
+    size_t full_block_size;
+
+    int codec_config;
+    int32_t ws_output_size;
+
+    bool hit_loop;
+    int32_t loop_current_sample;
+    int32_t loop_samples_into_block;
+    off_t loop_block_offset;
+    size_t loop_block_size;
+    int32_t loop_block_samples;
+    off_t loop_next_block_offset;
+    size_t loop_full_block_size;
+} seek_point_t;
+
+/* state before block_update */
+typedef struct {
+    int32_t current_sample;
+    off_t block_offset;
+    int codec_config;               /* some layouts use it as a counter */
+    size_t full_block_size;         /* some layouts use it as prev block's size or a counter */
+    bool hit_loop;
+} seek_block_t;
+
+typedef struct {
+    off_t offset;
+    off_t channel_start_offset;
+    int32_t adpcm_history1_32;
+    int32_t adpcm_history2_32;
+    int32_t adpcm_history3_32;
+    int32_t adpcm_history4_32;
+    int adpcm_step_index;
+    uint16_t adx_xor;
+    uint16_t adx_mult;
+    uint16_t adx_add;
+} seek_block_ch_t;
+
+typedef struct {
+    int32_t interval;               /* min samples between points */
+
+    int channels;
+    seek_point_t* points;
+    VGMSTREAMCHANNEL* points_ch;    /* channel state per point (points * channels) */
+    int count;
+    int max;
+
+    bool blocked;                   /* using block points below rather than full points */
+    seek_block_t* blocks;
+    seek_block_ch_t* blocks_ch;     /* (blocks * channels) */
+    int blocks_count;
+    int blocks_max;
+} seek_index_t;
+
+
+static bool is_vgmstream_supported(VGMSTREAM* vgmstream) {
+    /* state that lives elsewhere can't be copied */
+    if (vgmstream->codec_data || vgmstream->layout_data)
+        return false;
+    if (vgmstream->layout_type == layout_segmented || vgmstream->layout_type == layout_layered)
+        return false;
+    return true;
+}
+
+/* max position where a point is valid for any loop pass */
+static int32_t get_max_sample(VGMSTREAM* vgmstream) {
+    bool is_looped = vgmstream->loop_flag || vgmstream->loop_target > 0;
+
+    if (is_looped && decode_keeps_loop_history(vgmstream))
+        return vgmstream->loop_start_sample;
+    if (vgmstream->loop_flag)
+        return vgmstream->loop_end_sample;
+    return vgmstream->num_samples;
+}
+
+static void save_point(VGMSTREAM* vgmstream, seek_point_t* point, VGMSTREAMCHANNEL* point_ch) {
+    point->current_sample = vgmstream->current_sample;
+    point->samples_into_block = vgmstream->samples_into_block;
+    point->current_block_offset = vgmstream->current_block_offset;
+    point->current_block_size = vgmstream->current_block_size;
+    point->current_block_samples = vgmstream->current_block_samples;
+    point->next_block_offset = vgmstream->next_block_offset;
+    point->full_block_size = vgmstream->full_block_size;
+
+    point->codec_config = vgmstream->codec_config;
+    point->ws_output_size = vgmstream->ws_output_size;
+
+    point->hit_loop = vgmstream->hit_loop;
+    point->loop_current_sample = vgmstream->loop_current_sample;
+    point->loop_samples_into_block = vgmstream->loop_samples_into_block;
+    point->loop_block_offset = vgmstream->loop_block_offset;
+    point->loop_block_size = vgmstream->loop_block_size;
+    point->loop_block_samples = vgmstream->loop_block_samples;
+    point->loop_next_block_offset = vgmstream->loop_next_block_offset;
+    point->loop_full_block_size = vgmstream->loop_full_block_size;
+
+    memcpy(point_ch, vgmstream->ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+}
+
+static void load_point(VGMSTREAM* vgmstream, seek_point_t* point, VGMSTREAMCHANNEL* point_ch) {
+    vgmstream->current_sample = point->current_sample;
+    vgmstream->samples_into_block = point->samples_into_block;
+    vgmstream->current_block_offset = point->current_block_offset;
+    vgmstream->current_block_size = point->current_block_size;
+    vgmstream->current_block_samples = point->current_block_samples;
+    vgmstream->next_block_offset = point->next_block_offset;
+    vgmstream->full_block_size = point->full_block_size;
+
+    vgmstream->codec_config = point->codec_config;
+    vgmstream->ws_output_size = point->ws_output_size;
+
+    /* loop_ch was saved when hit_loop was set (may happen if seeking to a loop point from the start) */
+    vgmstream->hit_loop = point->hit_loop;
+    vgmstream->loop_current_sample = point->loop_current_sample;
+    vgmstream->loop_samples_into_block = point->loop_samples_into_block;
+    vgmstream->loop_block_offset = point->loop_block_offset;
+    vgmstream->loop_block_size = point->loop_block_size;
+    vgmstream->loop_block_samples = point->loop_block_samples;
+    vgmstream->loop_next_block_offset = point->loop_next_block_offset;
+    vgmstream->loop_full_block_size = point->loop_full_block_size;
+
+    /* STREAMFILEs may have been changed after saving (see decode_parallel.c) */
+    for (int ch = 0; ch < vgmstream->channels; ch++) {
+        STREAMFILE* sf = vgmstream->ch[ch].streamfile;
+        vgmstream->ch[ch] = point_ch[ch];
+        vgmstream->ch[ch].streamfile = sf;
+    }
+}
+
+void seek_index_record(VGMSTREAM* vgmstream) {
+    seek_index_t* index = vgmstream->seek_index;
+    if (!index || index->blocked)
+        return;
+
+    int32_t current_sample = vgmstream->current_sample;
+    int32_t last_sample = index->count ? index->points[index->count - 1].current_sample : 0;
+    if (current_sample < last_sample + index->interval)
+        return;
+    if (current_sample > get_max_sample(vgmstream))
+        return;
+
+    if (index->count >= index->max) {
+        int new_max = index->max ? index->max * 2 : 64;
+
+        seek_point_t* new_points = realloc(index->points, new_max * sizeof(seek_point_t));
+        if (!new_points) return;
+        index->points = new_points;
+
+        VGMSTREAMCHANNEL* new_points_ch = realloc(index->points_ch, new_max * index->channels * sizeof(VGMSTREAMCHANNEL));
+        if (!new_points_ch) return;
+        index->points_ch = new_points_ch;
+
+        index->max = new_max;
+    }
+
+    save_point(vgmstream, &index->points[index->count], &index->points_ch[index->count * index->channels]);
+    index->count++;
+}
+
+/* codecs with state that block points don't save */
+static bool is_block_state_supported(VGMSTREAM* vgmstream) {
+    switch (vgmstream->coding_type) {
+        case coding_G721:
+        case coding_WS:
+            return false;
+        default:
+            return true;
+    }
+}
+
+void seek_index_record_block(VGMSTREAM* vgmstream) {
+    seek_index_t* index = vgmstream->seek_index;
+    if (!index || !is_block_state_supported(vgmstream))
+        return;
+
+    /* full points may exist if decoding didn't reach a block change yet */
+    if (!index->blocked) {
+        index->blocked = true;
+        index->count = 0;
+    }
+
+    int32_t current_sample = vgmstream->current_sample;
+    int32_t last_sample = index->blocks_count ? index->blocks[index->blocks_count - 1].current_sample : 0;
+    if (current_sample < last_sample + SEEK_INDEX_MIN_BLOCK_INTERVAL)
+        return;
+    if (current_sample > get_max_sample(vgmstream))
+        return;
+
+    if (index->blocks_count >= index->blocks_max) {
+        int new_max = index->blocks_max ? index->blocks_max * 2 : 256;
+
+        seek_block_t* new_blocks = realloc(index->blocks, new_max * sizeof(seek_block_t));
+        if (!new_blocks) return;
+        index->blocks = new_blocks;
+
+        seek_block_ch_t* new_blocks_ch = realloc(index->blocks_ch, new_max * index->channels * sizeof(seek_block_ch_t));
+        if (!new_blocks_ch) return;
+        index->blocks_ch = new_blocks_ch;
+
+        index->blocks_max = new_max;
+    }
+
+    /* saved history must include queued frames */
+    if (vgmstream->parallel_data) {
+        decode_parallel_flush(vgmstream);
+    }
+
+    seek_block_t* block = &index->blocks[index->blocks_count];
+    seek_block_ch_t* block_ch = &index->blocks_ch[index->blocks_count * index->channels];
+
+    block->current_sample = current_sample;
+    block->block_offset = vgmstream->next_block_offset;
+    block->codec_config = vgmstream->codec_config;
+    block->full_block_size = vgmstream->full_block_size;
+    block->hit_loop = vgmstream->hit_loop;
+    for (int ch = 0; ch < vgmstream->channels; ch++) {
+        VGMSTREAMCHANNEL* vch = &vgmstream->ch[ch];
+
+        block_ch[ch].offset = vch->offset;
+        block_ch[ch].channel_start_offset = vch->channel_start_offset;
+        block_ch[ch].adpcm_history1_32 = vch->adpcm_history1_32;
+        block_ch[ch].adpcm_history2_32 = vch->adpcm_history2_32;
+        block_ch[ch].adpcm_history3_32 = vch->adpcm_history3_32;
+        block_ch[ch].adpcm_history4_32 = vch->adpcm_history4_32;
+        block_ch[ch].adpcm_step_index = vch->adpcm_step_index;
+        block_ch[ch].adx_xor = vch->adx_xor;
+        block_ch[ch].adx_mult = vch->adx_mult;
+        block_ch[ch].adx_add = vch->adx_add;
+    }
+
+    index->blocks_count++;
+}
+
+static int32_t restore_block(VGMSTREAM* vgmstream, seek_index_t* index, int32_t target_sample) {
+    int32_t current_sample = vgmstream->current_sample;
+
+    /* find last block <= target */
+    int lo = 0, hi = index->blocks_count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (index->blocks[mid].current_sample <= target_sample) {
+            found = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    /* loop state (loop_ch) isn't saved so must match */
+    while (found >= 0 && index->blocks[found].hit_loop != vgmstream->hit_loop) {
+        found--;
+    }
+
+    if (found < 0 || index->blocks[found].current_sample <= current_sample)
+        return 0;
+
+    seek_block_t* block = &index->blocks[found];
+    seek_block_ch_t* block_ch = &index->blocks_ch[found * index->channels];
+
+    if (vgmstream->parallel_data) {
+        decode_parallel_flush(vgmstream);
+    }
+
+    vgmstream->codec_config = block->codec_config;
+    vgmstream->full_block_size = block->full_block_size;
+    for (int ch = 0; ch < vgmstream->channels; ch++) {
+        VGMSTREAMCHANNEL* vch = &vgmstream->ch[ch];
+
+        vch->offset = block_ch[ch].offset;
+        vch->channel_start_offset = block_ch[ch].channel_start_offset;
+        vch->adpcm_history1_32 = block_ch[ch].adpcm_history1_32;
+        vch->adpcm_history2_32 = block_ch[ch].adpcm_history2_32;
+        vch->adpcm_history3_32 = block_ch[ch].adpcm_history3_32;
+        vch->adpcm_history4_32 = block_ch[ch].adpcm_history4_32;
+        vch->adpcm_step_index = block_ch[ch].adpcm_step_index;
+        vch->adx_xor = block_ch[ch].adx_xor;
+        vch->adx_mult = block_ch[ch].adx_mult;
+        vch->adx_add = block_ch[ch].adx_add;
+    }
+
+    /* same as the layout moving to next block */
+    block_update(block->block_offset, vgmstream);
+    vgmstream->current_sample = block->current_sample;
+    vgmstream->samples_into_block = 0;
+
+    return vgmstream->current_sample - current_sample;
+}
+
+static int32_t restore_point(VGMSTREAM* vgmstream, seek_index_t* index, int32_t target_sample) {
+    int32_t current_sample = vgmstream->current_sample;
+
+    /* find last point <= target */
+    int lo = 0, hi = index->count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (index->points[mid].current_sample <= target_sample) {
+            found = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    if (found < 0 || index->points[found].current_sample <= current_sample)
+        return 0;
+
+    load_point(vgmstream, &index->points[found], &index->points_ch[found * index->channels]);
+    return vgmstream->current_sample - current_sample;
+}
+
+int32_t seek_index_restore(VGMSTREAM* vgmstream, int32_t samples) {
+    seek_index_t* index = vgmstream->seek_index;
+    if (!index)
+        return 0;
+
+    int32_t target_sample = vgmstream->current_sample + samples;
+    int32_t max_sample = get_max_sample(vgmstream);
+    if (target_sample > max_sample)
+        target_sample = max_sample;
+
+    if (index->blocked)
+        return restore_block(vgmstream, index, target_sample);
+    else
+        return restore_point(vgmstream, index, target_sample);
+}
+
+
+static void free_index(seek_index_t* index) {
+    if (!index)
+        return;
+    free(index->points);
+    free(index->points_ch);
+    free(index->blocks);
+    free(index->blocks_ch);
+    free(index);
+}
+
+void seek_index_free(VGMSTREAM* vgmstream) {
+    if (!vgmstream)
+        return;
+
+    free_index(vgmstream->seek_index);
+    vgmstream->seek_index = NULL;
+}
+
+void seek_index_clear(VGMSTREAM* vgmstream) {
+    seek_index_t* index = vgmstream->seek_index;
+    if (!index)
+        return;
+    index->count = 0;
+    index->blocks_count = 0;
+}
+
+void seek_index_copy(VGMSTREAM* dst, VGMSTREAM* src) {
+    seek_index_t* dst_index = dst->seek_index;
+    seek_index_t* src_index = src->seek_index;
+    if (!dst_index || !src_index || dst_index->channels != src_index->channels)
+        return;
+
+    seek_point_t* points = NULL;
+    VGMSTREAMCHANNEL* points_ch = NULL;
+    seek_block_t* blocks = NULL;
+    seek_block_ch_t* blocks_ch = NULL;
+    int channels = src_index->channels;
+
+    if (src_index->count) {
+        points = malloc(src_index->count * sizeof(seek_point_t));
+        points_ch = malloc(src_index->count * channels * sizeof(VGMSTREAMCHANNEL));
+        if (!points || !points_ch) goto fail;
+        memcpy(points, src_index->points, src_index->count * sizeof(seek_point_t));
+        memcpy(points_ch, src_index->points_ch, src_index->count * channels * sizeof(VGMSTREAMCHANNEL));
+    }
+
+    if (src_index->blocks_count) {
+        blocks = malloc(src_index->blocks_count * sizeof(seek_block_t));
+        blocks_ch = malloc(src_index->blocks_count * channels * sizeof(seek_block_ch_t));
+        if (!blocks || !blocks_ch) goto fail;
+        memcpy(blocks, src_index->blocks, src_index->blocks_count * sizeof(seek_block_t));
+        memcpy(blocks_ch, src_index->blocks_ch, src_index->blocks_count * channels * sizeof(seek_block_ch_t));
+    }
+
+    /* points_ch's STREAMFILEs are the source's, but load_point keeps current ones */
+    free(dst_index->points);
+    free(dst_index->points_ch);
+    free(dst_index->blocks);
+    free(dst_index->blocks_ch);
+
+    dst_index->interval = src_index->interval;
+    dst_index->points = points;
+    dst_index->points_ch = points_ch;
+    dst_index->count = src_index->count;
+    dst_index->max = src_index->count;
+    dst_index->blocked = src_index->blocked;
+    dst_index->blocks = blocks;
+    dst_index->blocks_ch = blocks_ch;
+    dst_index->blocks_count = src_index->blocks_count;
+    dst_index->blocks_max = src_index->blocks_count;
+    return;
+fail:
+    free(points);
+    free(points_ch);
+    free(blocks);
+    free(blocks_ch);
+}
+
+bool seek_index_enable(VGMSTREAM* vgmstream, bool enable) {
+    if (!vgmstream)
+        return false;
+
+    if (vgmstream->layout_type == layout_segmented) {
+        segmented_layout_data* layout_data = vgmstream->layout_data;
+        for (int i = 0; i < layout_data->segment_count; i++) {
+            if (!seek_index_enable(layout_data->segments[i], enable))
+                return false;
+        }
+    }
+
+    if (vgmstream->layout_type == layout_layered) {
+        layered_layout_data* layout_data = vgmstream->layout_data;
+        for (int i = 0; i < layout_data->layer_count; i++) {
+            if (!seek_index_enable(layout_data->layers[i], enable))
+                return false;
+        }
+    }
+
+    seek_index_free(vgmstream);
+
+    if (enable && is_vgmstream_supported(vgmstream)) {
+        seek_index_t* index = calloc(1, sizeof(seek_index_t));
+        if (!index) return false;
+
+        index->channels = vgmstream->channels;
+        index->interval = vgmstream->sample_rate; /* decodes at most ~1s per seek */
+        if (index->interval < SEEK_INDEX_MIN_INTERVAL)
+            index->interval = SEEK_INDEX_MIN_INTERVAL;
+
+        vgmstream->seek_index = index;
+    }
+
+    /* must survive resets */
+    ((VGMSTREAM*)vgmstream->start_vgmstream)->seek_index = vgmstream->seek_index;
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef _SEEK_INDEX_H
+#define _SEEK_INDEX_H
+
+#include "../vgmstream.h"
+
+/* Enables recording decoder checkpoints while decoding (or removes them if disabled), so later seeks can
+ * restore the nearest one and decode less. Only for simple codecs and layouts that keep all state in the
+ * VGMSTREAM and its channels, others decode as usual. Also applies to segments/layers. */
+bool seek_index_enable(VGMSTREAM* vgmstream, bool enable);
+
+void seek_index_free(VGMSTREAM* vgmstream);
+
+/* Copies checkpoints saved so far into another VGMSTREAM of the same stream/config (with seek index enabled). */
+void seek_index_copy(VGMSTREAM* dst, VGMSTREAM* src);
+
+/* Forgets saved checkpoints (must be called if loop points change). */
+void seek_index_clear(VGMSTREAM* vgmstream);
+
+/* Saves current decoder state if far enough from last checkpoint (called after rendering layouts). */
+void seek_index_record(VGMSTREAM* vgmstream);
+
+/* Saves state before moving to next block (called by blocked layouts). */
+void seek_index_record_block(VGMSTREAM* vgmstream);
+
+/* Moves decoder to the nearest checkpoint between current sample and current + samples (if any).
+ * Returns skipped samples, that don't need to be decoded. */
+int32_t seek_index_restore(VGMSTREAM* vgmstream, int32_t samples);
+
+#endif
@@ -127,6 +127,7 @@ STREAMFILE* open_buffer_streamfile(STREAMFILE* sf, size_t buf_size) {
     this_sf->vt.open = (void*)buffer_open;
     this_sf->vt.close = (void*)buffer_close;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.parse_threads = sf->parse_threads;
 
     this_sf->inner_sf = sf;
     this_sf->buf_size = buf_size;
@@ -73,6 +73,7 @@ STREAMFILE* open_clamp_streamfile(STREAMFILE* sf, offv_t start, size_t size) {
     this_sf->vt.open = (void*)clamp_open;
     this_sf->vt.close = (void*)clamp_close;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.parse_threads = sf->parse_threads;
 
     this_sf->inner_sf = sf;
     this_sf->start = start;
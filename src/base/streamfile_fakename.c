@@ -66,6 +66,7 @@ STREAMFILE* open_fakename_streamfile(STREAMFILE* sf, const char* fakename, const
     this_sf->vt.open = (void*)fakename_open;
     this_sf->vt.close = (void*)fakename_close;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.parse_threads = sf->parse_threads;
 
     this_sf->inner_sf = sf;
 
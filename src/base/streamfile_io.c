@@ -63,6 +63,7 @@ STREAMFILE* open_io_streamfile_ex(STREAMFILE* sf, void* data, size_t data_size,
     this_sf->vt.open = (void*)io_open;
     this_sf->vt.close = (void*)io_close;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.parse_threads = sf->parse_threads;
 
     this_sf->inner_sf = sf;
     if (data) {
@@ -133,6 +133,7 @@ STREAMFILE* open_multifile_streamfile(STREAMFILE** sfs, size_t sfs_size) {
     this_sf->vt.open = (void*)multifile_open;
     this_sf->vt.close = (void*)multifile_close;
     this_sf->vt.stream_index = sfs[0]->stream_index;
+    this_sf->vt.parse_threads = sfs[0]->parse_threads;
 
     this_sf->inner_sfs_size = sfs_size;
     this_sf->inner_sfs = calloc(sfs_size, sizeof(STREAMFILE*));
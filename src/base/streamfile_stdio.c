@@ -19,8 +19,11 @@
  * bigfiles (some later MSVC versions) or PS2 .RSD (Mac), where 2nd channel = 2nd SF reads garbage at some points.
  *
  * Keep it for other systems since this is (probably) kinda useful, though a more sensible approach would be
- * redoing SF/FILE/buffer handling to avoid re-opening as much. */
-#if !defined (_MSC_VER) && !defined (__ANDROID__) && !defined (__APPLE__)
+ * redoing SF/FILE/buffer handling to avoid re-opening as much.
+ *
+ * Dupe'd FDs also share the file position, so reads use pread (doesn't move the position) as channels
+ * may be read from different threads (and Windows/MinGW doesn't have pread). */
+#if !defined (_MSC_VER) && !defined (__ANDROID__) && !defined (__APPLE__) && !defined (_WIN32)
     #define USE_STDIO_FDUP 1
 #endif
  
@@ -156,6 +159,33 @@ static size_t stdio_read(STDIO_STREAMFILE* sf, uint8_t* dst, offv_t offset, size
             break;
         }
 
+        /* big reads go straight to dst, as buffering them would just add a copy (and the next small
+         * read after them likely needs a refill anyway). Only done here: API streamfiles pass reads
+         * to the caller's libstreamfile_t as-is, and buffer streamfiles still copy. */
+        if (length >= sf->buf_size) {
+            size_t bytes_read;
+#ifdef USE_STDIO_FDUP
+            ssize_t bytes = pread(fileno(sf->infile), dst, length, offset);
+            bytes_read = bytes > 0 ? bytes : 0;
+#else
+            if (fseek_v(sf->infile, offset, SEEK_SET)) {
+                break;
+            }
+            bytes_read = fread(dst, sizeof(uint8_t), length, sf->infile);
+#endif
+            offset += bytes_read;
+            read_total += bytes_read;
+            break; /* done or EOF */
+        }
+
+#ifdef USE_STDIO_FDUP
+        /* fill the buffer at offset without touching the (shared) file position */
+        {
+            ssize_t bytes = pread(fileno(sf->infile), sf->buf, sf->buf_size, offset);
+            sf->buf_offset = offset;
+            sf->valid_size = bytes > 0 ? bytes : 0;
+        }
+#else
         /* position to new offset */
         if (fseek_v(sf->infile, offset, SEEK_SET)) {
             break; /* this shouldn't happen in our code */
@@ -169,6 +199,7 @@ static size_t stdio_read(STDIO_STREAMFILE* sf, uint8_t* dst, offv_t offset, size
         /* fill the buffer (offset now is beyond buf_offset) */
         sf->buf_offset = offset;
         sf->valid_size = fread(sf->buf, sizeof(uint8_t), sf->buf_size, sf->infile);
+#endif
         //;VGM_LOG("stdio: read buf %lx + %x\n", sf->buf_offset, sf->valid_size);
 
         /* decide how much must be read this time */
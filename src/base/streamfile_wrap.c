@@ -48,6 +48,7 @@ STREAMFILE* open_wrap_streamfile(STREAMFILE* sf) {
     this_sf->vt.open = (void*)wrap_open;
     this_sf->vt.close = (void*)wrap_close;
     this_sf->vt.stream_index = sf->stream_index;
+    this_sf->vt.parse_threads = sf->parse_threads;
 
     this_sf->inner_sf = sf;
 
@@ -3,11 +3,15 @@
 #ifdef VGM_USE_ATRAC9
 #include "libatrac9.h"
 
+/* max superframes read and decoded per call (superframes are small, so this saves many tiny reads) */
+#define ATRAC9_MAX_SUPERFRAMES  16
+
 
 /* opaque struct */
 struct atrac9_codec_data {
     uint8_t* data_buffer;
     size_t data_buffer_size;
+    int superframe_samples;
 
     sample_t* sample_buffer;
     size_t samples_filled; /* number of samples in the buffer */
@@ -47,12 +51,14 @@ atrac9_codec_data* init_atrac9(atrac9_config* cfg) {
     }
 
 
-    /* must hold at least one superframe and its samples */
-    data->data_buffer_size = data->info.superframeSize;
+    /* must hold at least one superframe and its samples (more to batch reads) */
+    data->superframe_samples = data->info.frameSamples * data->info.framesInSuperframe;
+    data->data_buffer_size = data->info.superframeSize * ATRAC9_MAX_SUPERFRAMES;
     /* extra leeway as Atrac9Decode seems to overread ~2 bytes (doesn't affect decoding though) */
     data->data_buffer = calloc(data->data_buffer_size + 0x10, sizeof(uint8_t));
     /* while ATRAC9 uses float internally, Sony's API only returns PCM16 */
-    data->sample_buffer = calloc(data->info.channels * data->info.frameSamples * data->info.framesInSuperframe, sizeof(sample_t));
+    data->sample_buffer = calloc(data->info.channels * data->superframe_samples * ATRAC9_MAX_SUPERFRAMES, sizeof(sample_t));
+    if (!data->data_buffer || !data->sample_buffer) goto fail;
 
     data->samples_to_discard = cfg->encoder_delay;
 
@@ -99,9 +105,10 @@ void decode_atrac9(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t samples_to_do
             data->samples_filled -= samples_to_get;
         }
         else { /* decode data */
-            int iframe, status;
+            int iframe, isuperframe, status;
             int bytes_used = 0;
-            uint8_t *buffer = data->data_buffer;
+            uint8_t* buffer = data->data_buffer;
+            int superframes;
             size_t bytes;
 
             data->samples_used = 0;
@@ -109,19 +116,30 @@ void decode_atrac9(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t samples_to_do
             /* ATRAC9 is made of decodable superframes with several sub-frames. AT9 config data gives
              * superframe size, number of frames and samples (~100-200 bytes and ~256/1024 samples). */
 
-            /* read one raw block (superframe) and advance offsets */
-            bytes = read_streamfile(data->data_buffer,stream->offset, data->info.superframeSize,stream->streamfile);
-            if (bytes != data->data_buffer_size) goto decode_fail;
-
-            stream->offset += bytes;
-
-            /* decode all frames in the superframe block */
-            for (iframe = 0; iframe < data->info.framesInSuperframe; iframe++) {
-                status = Atrac9Decode(data->handle, buffer, data->sample_buffer + data->samples_filled*channels, &bytes_used);
-                if (status < 0) goto decode_fail;
-
-                buffer += bytes_used;
-                data->samples_filled += data->info.frameSamples;
+            /* superframes needed to fill the request (not more as the decoder may be looping soon) */
+            superframes = (data->samples_to_discard + (samples_to_do - samples_done) + data->superframe_samples - 1) / data->superframe_samples;
+            if (superframes > ATRAC9_MAX_SUPERFRAMES)
+                superframes = ATRAC9_MAX_SUPERFRAMES;
+            if (superframes < 1)
+                superframes = 1;
+
+            /* read raw blocks (superframes) in one go, may get less near file end */
+            bytes = read_streamfile(data->data_buffer, stream->offset, superframes * data->info.superframeSize, stream->streamfile);
+            superframes = bytes / data->info.superframeSize;
+            if (superframes <= 0) goto decode_fail;
+
+            /* decode all frames in each superframe block */
+            for (isuperframe = 0; isuperframe < superframes; isuperframe++) {
+                buffer = data->data_buffer + isuperframe * data->info.superframeSize;
+                stream->offset += data->info.superframeSize;
+
+                for (iframe = 0; iframe < data->info.framesInSuperframe; iframe++) {
+                    status = Atrac9Decode(data->handle, buffer, data->sample_buffer + data->samples_filled*channels, &bytes_used);
+                    if (status < 0) goto decode_fail;
+
+                    buffer += bytes_used;
+                    data->samples_filled += data->info.frameSamples;
+                }
             }
         }
     }
@@ -134,6 +152,24 @@ decode_fail:
     memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * sizeof(sample_t) * channels);
 }
 
+/* reopens the decoder, to drop any state left from previously decoded frames */
+static bool reopen_handle(atrac9_codec_data* data) {
+    int status;
+    uint8_t config_data[4];
+
+    Atrac9ReleaseHandle(data->handle);
+    data->handle = Atrac9GetHandle();
+    if (!data->handle) goto fail;
+
+    put_u32be(config_data, data->config.config_data);
+    status = Atrac9InitDecoder(data->handle, config_data);
+    if (status < 0) goto fail;
+
+    return true;
+fail:
+    return false;
+}
+
 void reset_atrac9(atrac9_codec_data* data) {
     if (!data) return;
 
@@ -142,18 +178,8 @@ void reset_atrac9(atrac9_codec_data* data) {
 
 #if 0
     /* reopen/flush, not needed as superframes decode separatedly and there is no carried state */
-    {
-        int status;
-        uint8_t config_data[4];
-
-        Atrac9ReleaseHandle(data->handle);
-        data->handle = Atrac9GetHandle();
-        if (!data->handle) goto fail;
-
-        put_u32be(config_data, data->config.config_data);
-        status = Atrac9InitDecoder(data->handle, config_data);
-        if (status < 0) goto fail;
-    }
+    if (!reopen_handle(data))
+        goto fail;
 #endif
 
     data->samples_used = 0;
@@ -166,36 +192,40 @@ fail:
     return; /* decode calls should fail... */
 }
 
-void seek_atrac9(VGMSTREAM* vgmstream, int32_t num_sample) {
-    atrac9_codec_data* data = vgmstream->codec_data;
-    if (!data) return;
+/* finds closest offset to desired sample, and samples to discard after that offset */
+static void seek_superframe(atrac9_codec_data* data, VGMSTREAMCHANNEL* stream, int32_t num_sample) {
+    int32_t seek_sample = data->config.encoder_delay + num_sample;
+    off_t seek_offset;
+    int32_t seek_discard;
+    int32_t superframe_samples = data->superframe_samples;
+    size_t superframe_number, superframe_back;
 
-    reset_atrac9(data);
+    superframe_number = (seek_sample / superframe_samples); /* closest */
 
-    /* find closest offset to desired sample, and samples to discard after that offset to reach loop */
-    {
-        int32_t seek_sample = data->config.encoder_delay + num_sample;
-        off_t seek_offset;
-        int32_t seek_discard;
-        int32_t superframe_samples = data->info.frameSamples * data->info.framesInSuperframe;
-        size_t superframe_number, superframe_back;
+    /* decoded frames affect each other slightly, so move offset back to make PCM stable
+     * and equivalent to a full discard loop */
+    superframe_back = 1; /* 1 seems enough (even when only 1 subframe in superframe) */
+    if (superframe_back > superframe_number)
+        superframe_back = superframe_number;
 
-        superframe_number = (seek_sample / superframe_samples); /* closest */
+    seek_discard = (seek_sample % superframe_samples) + (superframe_back * superframe_samples);
+    seek_offset  = (superframe_number - superframe_back) * data->info.superframeSize;
 
-        /* decoded frames affect each other slightly, so move offset back to make PCM stable
-         * and equivalent to a full discard loop */
-        superframe_back = 1; /* 1 seems enough (even when only 1 subframe in superframe) */
-        if (superframe_back > superframe_number)
-            superframe_back = superframe_number;
+    data->samples_used = 0;
+    data->samples_filled = 0;
+    data->samples_to_discard = seek_discard; /* already includes encoder delay */
 
-        seek_discard = (seek_sample % superframe_samples) + (superframe_back * superframe_samples);
-        seek_offset  = (superframe_number - superframe_back) * data->info.superframeSize;
+    stream->offset = stream->channel_start_offset + seek_offset;
+}
 
-        data->samples_to_discard = seek_discard; /* already includes encoder delay */
+void seek_atrac9(VGMSTREAM* vgmstream, int32_t num_sample) {
+    atrac9_codec_data* data = vgmstream->codec_data;
+    if (!data) return;
 
-        if (vgmstream->loop_ch)
-            vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset + seek_offset;
-    }
+    reset_atrac9(data);
+
+    if (vgmstream->loop_ch)
+        seek_superframe(data, &vgmstream->loop_ch[0], num_sample);
 
 #if 0
     //old full discard loop
@@ -211,6 +241,23 @@ void seek_atrac9(VGMSTREAM* vgmstream, int32_t num_sample) {
 
 }
 
+/* skips samples from current position by moving to the target superframe, returns skipped samples */
+int32_t skip_atrac9(VGMSTREAM* vgmstream, int32_t samples) {
+    atrac9_codec_data* data = vgmstream->codec_data;
+    if (!data) return 0;
+
+    /* not worth it if target is in the next few superframes */
+    if (data->samples_to_discard + samples < data->samples_filled + 2 * data->superframe_samples)
+        return 0;
+
+    /* start clean from the pre-roll superframe, as if decoding from there (rather than after the last decoded one) */
+    if (!data->handle || !reopen_handle(data))
+        return 0;
+
+    seek_superframe(data, &vgmstream->ch[0], vgmstream->current_sample + samples);
+    return samples;
+}
+
 void free_atrac9(atrac9_codec_data* data) {
     if (!data) return;
 
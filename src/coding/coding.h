@@ -356,12 +356,15 @@ typedef struct {
     uint64_t key;
     uint16_t subkey;
     uint64_t best_key;
+    uint16_t best_subkey;
     int best_score;
     /* internals */
     uint32_t start_offset;
 } hca_keytest_t;
 
 void test_hca_key(hca_codec_data* data, hca_keytest_t* hk);
+/* Tests keys in order (with optional per key subkeys, otherwise uses hk's) until a perfect score, using up to N threads if possible. */
+void test_hca_keys(hca_codec_data* data, hca_keytest_t* hk, const uint64_t* keys, const uint16_t* subkeys, int keys_count, int threads);
 void hca_set_encryption_key(hca_codec_data* data, uint64_t keycode, uint64_t subkey);
 
 STREAMFILE* hca_get_streamfile(hca_codec_data* data);
@@ -464,6 +467,8 @@ void decode_vorbis_custom(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t sample
 void reset_vorbis_custom(VGMSTREAM* vgmstream);
 void seek_vorbis_custom(VGMSTREAM* vgmstream, int32_t num_sample);
 void free_vorbis_custom(vorbis_custom_codec_data* data);
+/* frees setups cached between files (process-wide) */
+void free_vorbis_custom_cache(void);
 #endif
 
 typedef struct {
@@ -524,6 +529,7 @@ mpeg_codec_data* init_mpeg_custom(STREAMFILE* sf, off_t start_offset, coding_t*
 void decode_mpeg(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t samples_to_do, int channels);
 void reset_mpeg(mpeg_codec_data* data);
 void seek_mpeg(VGMSTREAM* vgmstream, int32_t num_sample);
+int32_t skip_mpeg(VGMSTREAM* vgmstream, int32_t samples);
 void free_mpeg(mpeg_codec_data* data);
 
 int mpeg_get_sample_rate(mpeg_codec_data* data);
@@ -591,6 +597,7 @@ atrac9_codec_data* init_atrac9(atrac9_config* cfg);
 void decode_atrac9(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t samples_to_do, int channels);
 void reset_atrac9(atrac9_codec_data* data);
 void seek_atrac9(VGMSTREAM* vgmstream, int32_t num_sample);
+int32_t skip_atrac9(VGMSTREAM* vgmstream, int32_t samples);
 void free_atrac9(atrac9_codec_data* data);
 size_t atrac9_bytes_to_samples(size_t bytes, atrac9_codec_data* data);
 size_t atrac9_bytes_to_samples_cfg(size_t bytes, uint32_t config_data);
@@ -651,6 +658,19 @@ int ffmpeg_get_subsong_count(ffmpeg_codec_data* data);
 
 STREAMFILE* ffmpeg_get_streamfile(ffmpeg_codec_data* data);
 
+/* custom packet reader, for codecs that don't need a container (FFmpeg's sf is passed to reads) */
+typedef struct {
+    void* data;
+    /* reads next packet into buf, returns size (0 on EOF, <0 on error) */
+    int (*read)(void* data, STREAMFILE* sf, uint8_t* buf, int buf_size);
+    /* restarts packets from the beginning */
+    void (*reset)(void* data);
+    void (*close)(void* data);
+} ffmpeg_packet_reader_t;
+
+ffmpeg_codec_data* init_ffmpeg_packets(STREAMFILE* sf, const char* const* codec_names, const uint8_t* extradata, int extradata_size,
+        int channels, int sample_rate, ffmpeg_packet_reader_t* reader);
+
 /* ffmpeg_decoder_utils.c (helper-things) */
 ffmpeg_codec_data* init_ffmpeg_atrac3_raw(STREAMFILE* sf, off_t offset, size_t data_size, int sample_count, int channels, int sample_rate, int block_align, int encoder_delay);
 ffmpeg_codec_data* init_ffmpeg_atrac3_riff(STREAMFILE* sf, off_t offset, int* out_samples);
@@ -1,5 +1,7 @@
 #include <math.h>
 #include "coding.h"
+#include "../util/samples_ops.h"
+#include "../util/threads.h"
 
 #ifdef VGM_USE_FFMPEG
 #include <libavcodec/avcodec.h>
@@ -20,6 +22,9 @@ struct ffmpeg_codec_data {
     uint64_t header_size;       // fake header (parseable by FFmpeg) prepended on reads
     uint8_t* header_block;      // fake header data (ie. RIFF)
 
+    ffmpeg_packet_reader_t reader; // custom packets fed directly to the decoder (no demuxer/IO if set)
+    uint8_t* packet_buf;
+
     /*** internal state ***/
     // config
     int stream_count;            /* FFmpeg audio streams (ignores video/etc) */
@@ -55,9 +60,17 @@ struct ffmpeg_codec_data {
 };
 
 
-#define FFMPEG_DEFAULT_IO_BUFFER_SIZE  STREAMFILE_DEFAULT_BUFFER_SIZE
+/* AVIO buffer, that demuxers read in chunks of this size (may be defined externally). Bigger buffers mean
+ * fewer callbacks/reads for high bitrate streams, while small files just use their size. Only stdio
+ * STREAMFILEs read those chunks into the AVIO buffer directly; others (like the API's) get the whole
+ * chunk as a single read, buffered however they do. */
+#ifndef FFMPEG_IO_BUFFER_SIZE
+#define FFMPEG_IO_BUFFER_SIZE  0x20000
+#endif
+#define FFMPEG_MIN_IO_BUFFER_SIZE  0x1000
+#define FFMPEG_MAX_PACKET_SIZE  0x10000
 
-static volatile int g_ffmpeg_initialized = 0;
+static bool g_ffmpeg_initialized = false;
 
 static void free_ffmpeg_config(ffmpeg_codec_data* data);
 static int init_ffmpeg_config(ffmpeg_codec_data* data, int target_subsong, int reset);
@@ -68,18 +81,16 @@ static int init_ffmpeg_config(ffmpeg_codec_data* data, int target_subsong, int r
 
 /* Global FFmpeg init */
 static void g_init_ffmpeg(void) {
-    if (g_ffmpeg_initialized == 1) {
-        while (g_ffmpeg_initialized < 2); /* active wait for lack of a better way */
-    }
-    else if (g_ffmpeg_initialized == 0) {
-        g_ffmpeg_initialized = 1;
+    vgm_global_lock();
+    if (!g_ffmpeg_initialized) {
         av_log_set_flags(AV_LOG_SKIP_REPEATED);
         av_log_set_level(AV_LOG_ERROR);
 //#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 18, 100)
 //        av_register_all(); /* not needed in newer versions */
 //#endif
-        g_ffmpeg_initialized = 2;
+        g_ffmpeg_initialized = true;
     }
+    vgm_global_unlock();
 }
 
 static void remap_audio(sample_t* outbuf, int sample_count, int channels, int* channel_mappings) {
@@ -294,6 +305,33 @@ static int64_t ffmpeg_seek(void* opaque, int64_t offset, int whence) {
 /* MAIN INIT/DECODER                            */
 /* ******************************************** */
 
+static int get_io_buffer_size(ffmpeg_codec_data* data) {
+    uint64_t size = data->logical_size;
+
+    /* whole file fits (padded a bit as FFmpeg probes in powers of 2) */
+    if (size < FFMPEG_IO_BUFFER_SIZE) {
+        size = (size + FFMPEG_MIN_IO_BUFFER_SIZE - 1) & ~(uint64_t)(FFMPEG_MIN_IO_BUFFER_SIZE - 1);
+        if (size < FFMPEG_MIN_IO_BUFFER_SIZE)
+            size = FFMPEG_MIN_IO_BUFFER_SIZE;
+        return (int)size;
+    }
+
+    return FFMPEG_IO_BUFFER_SIZE;
+}
+
+/* packet/frame are kept between resets and only unref'd */
+static int alloc_ffmpeg_buffers(ffmpeg_codec_data* data) {
+    if (!data->packet) {
+        data->packet = av_packet_alloc();
+        if (!data->packet) return 0;
+    }
+    if (!data->frame) {
+        data->frame = av_frame_alloc();
+        if (!data->frame) return 0;
+    }
+    return 1;
+}
+
 ffmpeg_codec_data* init_ffmpeg_offset(STREAMFILE* sf, uint64_t start, uint64_t size) {
     return init_ffmpeg_header_offset(sf, NULL,0, start,size);
 }
@@ -430,6 +468,74 @@ fail:
     return NULL;
 }
 
+/**
+ * Manually init FFmpeg for codecs that can be fed packets directly, without a demuxer.
+ *
+ * Rather than making some fake container for FFmpeg to parse back, the reader callback returns raw
+ * packets that are sent to the first decoder found in codec_names (FFmpeg's names, NULL terminated).
+ * Extradata is the codec's config, as FFmpeg's demuxer would set it. The reader is owned
+ * (and closed) by FFmpeg's data, even on errors.
+ */
+ffmpeg_codec_data* init_ffmpeg_packets(STREAMFILE* sf, const char* const* codec_names, const uint8_t* extradata, int extradata_size,
+        int channels, int sample_rate, ffmpeg_packet_reader_t* reader) {
+    ffmpeg_codec_data* data = NULL;
+    int errcode, i;
+
+
+    g_init_ffmpeg();
+
+    data = calloc(1, sizeof(ffmpeg_codec_data));
+    if (!data) goto fail;
+
+    data->reader = *reader;
+    reader->data = NULL; /* now owned */
+
+    data->sf = reopen_streamfile(sf, 0);
+    if (!data->sf) goto fail;
+
+    data->packet_buf = av_malloc(FFMPEG_MAX_PACKET_SIZE);
+    if (!data->packet_buf) goto fail;
+
+    for (i = 0; codec_names[i] != NULL; i++) {
+        data->codec = avcodec_find_decoder_by_name(codec_names[i]);
+        if (data->codec)
+            break;
+    }
+    if (!data->codec) goto fail;
+
+    data->codecCtx = avcodec_alloc_context3(data->codec);
+    if (!data->codecCtx) goto fail;
+
+    if (extradata_size > 0) {
+        data->codecCtx->extradata = av_mallocz(extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!data->codecCtx->extradata) goto fail;
+        memcpy(data->codecCtx->extradata, extradata, extradata_size);
+        data->codecCtx->extradata_size = extradata_size;
+    }
+
+    data->codecCtx->sample_rate = sample_rate;
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(59, 24, 100)
+    data->codecCtx->channels = channels;
+#else
+    av_channel_layout_default(&data->codecCtx->ch_layout, channels);
+#endif
+
+    errcode = avcodec_open2(data->codecCtx, data->codec, NULL);
+    if (errcode < 0) goto fail;
+
+    if (!alloc_ffmpeg_buffers(data)) goto fail;
+
+    data->stream_count = 1;
+    data->read_packet = 1;
+
+    return data;
+fail:
+    if (!data && reader->close)
+        reader->close(reader->data);
+    free_ffmpeg(data);
+    return NULL;
+}
+
 /* FFmpeg internals (roughly) for reference:
  * 
  *   // metadata info first extracted 
@@ -458,12 +564,13 @@ fail:
  */
 static int init_ffmpeg_config(ffmpeg_codec_data* data, int target_subsong, int reset) {
     int errcode = 0;
+    int buffer_size = get_io_buffer_size(data);
 
     /* custom IO/format setup */
-    data->buffer = av_malloc(FFMPEG_DEFAULT_IO_BUFFER_SIZE);
+    data->buffer = av_malloc(buffer_size);
     if (!data->buffer) goto fail;
 
-    data->ioCtx = avio_alloc_context(data->buffer, FFMPEG_DEFAULT_IO_BUFFER_SIZE, 0, data, ffmpeg_read, 0, ffmpeg_seek);
+    data->ioCtx = avio_alloc_context(data->buffer, buffer_size, 0, data, ffmpeg_read, 0, ffmpeg_seek);
     if (!data->ioCtx) goto fail;
 
     data->formatCtx = avformat_alloc_context();
@@ -527,15 +634,8 @@ static int init_ffmpeg_config(ffmpeg_codec_data* data, int target_subsong, int r
     errcode = avcodec_open2(data->codecCtx, data->codec, NULL);
     if (errcode < 0) goto fail;
 
-    /* prepare frame/packet buffers */
-    data->packet = av_malloc(sizeof(AVPacket)); /* av_packet_alloc? */
-    if (!data->packet) goto fail;
-    av_new_packet(data->packet, 0);
-    //av_packet_unref?
-
-    data->frame = av_frame_alloc();
-    if (!data->frame) goto fail;
-    av_frame_unref(data->frame);
+    /* prepare frame/packet buffers (reused on resets) */
+    if (!alloc_ffmpeg_buffers(data)) goto fail;
 
 
     return 0;
@@ -564,7 +664,26 @@ static int decode_ffmpeg_frame(ffmpeg_codec_data* data) {
 
     /* read data packets until valid is found */
     while (data->read_packet && !data->end_of_audio) {
-        if (!data->end_of_stream) {
+        if (!data->end_of_stream && data->reader.read) {
+            int size;
+
+            /* reset old packet */
+            av_packet_unref(data->packet);
+
+            /* read encoded data from custom reader into packet */
+            size = data->reader.read(data->reader.data, data->sf, data->packet_buf, FFMPEG_MAX_PACKET_SIZE);
+            if (size == 0) {
+                data->end_of_stream = 1;
+            }
+            else if (size < 0 || av_new_packet(data->packet, size) < 0) {
+                VGM_LOG("FFMPEG: custom packet read error=%i\n", size);
+                data->end_of_stream = 1; /* drain what's left */
+            }
+            else {
+                memcpy(data->packet->data, data->packet_buf, size);
+            }
+        }
+        else if (!data->end_of_stream) {
             /* reset old packet */
             av_packet_unref(data->packet);
 
@@ -650,13 +769,7 @@ fail:
  * flags, but probably should be enabled anyway to ensure no extra IEEE checks are needed.
  * MSVC added this in VS2015 (_MSC_VER 1900) but don't seem correctly optimized and is very slow.
  */
-static inline int float_to_int(float val) {
-#if defined(_MSC_VER)
-    return (int)val;
-#else
-    return lrintf(val);
-#endif
-}
+/* (float versions in samples_ops) */
 static inline int double_to_int(double val) {
 #if defined(_MSC_VER)
     return (int)val;
@@ -667,9 +780,8 @@ static inline int double_to_int(double val) {
 
 /* sample copy helpers, using different functions to minimize branches.
  *
- * in theory, small optimizations like *outbuf++ vs outbuf[i] or alt clamping
- * would matter for performance, but in practice aren't very noticeable;
- * keep it simple for now until more tests are done.
+ * common formats (s16p/s32/s32p/flt/fltp) use the vectorized kernels in samples_ops, that also
+ * de-interleave planes in chunks (multichannel XMA/AAC/etc spent a fair amount of time in these).
  *
  * in normal (interleaved) formats samples are laid out straight
  *  (ibuf[s*chs+ch], ex. 4ch with 4s: 0 1 2 3 0 1 2 3 0 1 2 3 0 1 2 3)
@@ -705,48 +817,7 @@ static void samples_u8p_to_s16(sample_t* obuf, uint8_t** ibuf, int ichs, int sam
     }
 }
 static void samples_s16_to_s16(sample_t* obuf, int16_t* ibuf, int ichs, int samples, int skip) {
-    int s, total_samples = samples * ichs;
-    for (s = 0; s < total_samples; s++) {
-        obuf[s] = ibuf[skip*ichs + s]; /* maybe should mempcy */
-    }
-}
-static void samples_s16p_to_s16(sample_t* obuf, int16_t** ibuf, int ichs, int samples, int skip) {
-    int s, ch;
-    for (ch = 0; ch < ichs; ch++) {
-        for (s = 0; s < samples; s++) {
-            obuf[s*ichs + ch] = ibuf[ch][skip + s];
-        }
-    }
-}
-static void samples_s32_to_s16(sample_t* obuf, int32_t* ibuf, int ichs, int samples, int skip) {
-    int s, total_samples = samples * ichs;
-    for (s = 0; s < total_samples; s++) {
-        obuf[s] = ibuf[skip*ichs + s] >> 16;
-    }
-}
-static void samples_s32p_to_s16(sample_t* obuf, int32_t** ibuf, int ichs, int samples, int skip) {
-    int s, ch;
-    for (ch = 0; ch < ichs; ch++) {
-        for (s = 0; s < samples; s++) {
-            obuf[s*ichs + ch] = ibuf[ch][skip + s] >> 16;
-        }
-    }
-}
-static void samples_flt_to_s16(sample_t* obuf, float* ibuf, int ichs, int samples, int skip, int invert) {
-    int s, total_samples = samples * ichs;
-    float scale = invert ? -32768.0f : 32768.0f;
-    for (s = 0; s < total_samples; s++) {
-        obuf[s] = clamp16(float_to_int(ibuf[skip*ichs + s] * scale));
-    }
-}
-static void samples_fltp_to_s16(sample_t* obuf, float** ibuf, int ichs, int samples, int skip, int invert) {
-    int s, ch;
-    float scale = invert ? -32768.0f : 32768.0f;
-    for (ch = 0; ch < ichs; ch++) {
-        for (s = 0; s < samples; s++) {
-            obuf[s*ichs + ch] = clamp16(float_to_int(ibuf[ch][skip + s] * scale));
-        }
-    }
+    memcpy(obuf, ibuf + skip*ichs, samples * ichs * sizeof(sample_t));
 }
 static void samples_dbl_to_s16(sample_t* obuf, double* ibuf, int ichs, int samples, int skip) {
     int s, total_samples = samples * ichs;
@@ -770,6 +841,8 @@ static void copy_samples(ffmpeg_codec_data* data, sample_t* outbuf, int samples_
     int channels = data->codecCtx->ch_layout.nb_channels;
 #endif
     int is_planar = av_sample_fmt_is_planar(data->codecCtx->sample_fmt) && (channels > 1);
+    int skip = data->samples_consumed;
+    float scale = data->invert_floats_set ? -32768.0f : 32768.0f;
     void* ibuf;
 
     if (is_planar) {
@@ -781,29 +854,29 @@ static void copy_samples(ffmpeg_codec_data* data, sample_t* outbuf, int samples_
 
     switch (data->codecCtx->sample_fmt) {
         /* unused? */
-        case AV_SAMPLE_FMT_U8P:  if (is_planar) { samples_u8p_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break; }
+        case AV_SAMPLE_FMT_U8P:  if (is_planar) { samples_u8p_to_s16(outbuf, ibuf, channels, samples_to_do, skip); break; }
             // fall through
-        case AV_SAMPLE_FMT_U8:   samples_u8_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break;
+        case AV_SAMPLE_FMT_U8:   samples_u8_to_s16(outbuf, ibuf, channels, samples_to_do, skip); break;
 
         /* common */
-        case AV_SAMPLE_FMT_S16P: if (is_planar) { samples_s16p_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break; }
+        case AV_SAMPLE_FMT_S16P: if (is_planar) { samples_s16p_to_s16(outbuf, ibuf, channels, skip, samples_to_do); break; }
             // fall through
-        case AV_SAMPLE_FMT_S16:  samples_s16_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break;
+        case AV_SAMPLE_FMT_S16:  samples_s16_to_s16(outbuf, ibuf, channels, samples_to_do, skip); break;
 
         /* possibly FLAC and other lossless codecs */
-        case AV_SAMPLE_FMT_S32P: if (is_planar) { samples_s32p_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break; }
+        case AV_SAMPLE_FMT_S32P: if (is_planar) { samples_s32p_to_s16(outbuf, ibuf, channels, skip, samples_to_do); break; }
             // fall through
-        case AV_SAMPLE_FMT_S32:  samples_s32_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break;
+        case AV_SAMPLE_FMT_S32:  samples_s32_to_s16(outbuf, (int32_t*)ibuf + skip * channels, samples_to_do * channels); break;
 
         /* mainly MDCT-like codecs (Ogg, AAC, etc) */
-        case AV_SAMPLE_FMT_FLTP: if (is_planar) { samples_fltp_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed, data->invert_floats_set); break; }
+        case AV_SAMPLE_FMT_FLTP: if (is_planar) { samples_f32p_to_s16(outbuf, ibuf, channels, skip, samples_to_do, scale); break; }
             // fall through
-        case AV_SAMPLE_FMT_FLT:  samples_flt_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed, data->invert_floats_set); break;
+        case AV_SAMPLE_FMT_FLT:  samples_f32_to_s16(outbuf, (float*)ibuf + skip * channels, samples_to_do * channels, scale); break;
 
         /* possibly PCM64 only (not enabled) */
-        case AV_SAMPLE_FMT_DBLP: if (is_planar) { samples_dblp_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break; }
+        case AV_SAMPLE_FMT_DBLP: if (is_planar) { samples_dblp_to_s16(outbuf, ibuf, channels, samples_to_do, skip); break; }
             // fall through
-        case AV_SAMPLE_FMT_DBL:  samples_dbl_to_s16(outbuf, ibuf, channels, samples_to_do, data->samples_consumed); break;
+        case AV_SAMPLE_FMT_DBL:  samples_dbl_to_s16(outbuf, ibuf, channels, samples_to_do, skip); break;
 
         default:
             break;
@@ -886,6 +959,11 @@ void seek_ffmpeg(ffmpeg_codec_data* data, int32_t num_sample) {
         errcode = init_ffmpeg_config(data, 0, 1);
         if (errcode < 0) goto fail;
     }
+    else if (data->reader.read) {
+        if (data->reader.reset)
+            data->reader.reset(data->reader.data);
+        avcodec_flush_buffers(data->codecCtx);
+    }
     else {
         avformat_seek_file(data->formatCtx, data->stream_index, 0, 0, 0, AVSEEK_FLAG_ANY);
         avcodec_flush_buffers(data->codecCtx);
@@ -916,15 +994,12 @@ static void free_ffmpeg_config(ffmpeg_codec_data* data) {
     if (data == NULL)
         return;
 
+    /* packet/frame may be reused after this (no need to alloc again) */
     if (data->packet) {
         av_packet_unref(data->packet);
-        av_free(data->packet);
-        data->packet = NULL;
     }
     if (data->frame) {
         av_frame_unref(data->frame);
-        av_free(data->frame);
-        data->frame = NULL;
     }
     if (data->codecCtx) {
         avcodec_close(data->codecCtx);
@@ -957,6 +1032,12 @@ void free_ffmpeg(ffmpeg_codec_data* data) {
         return;
 
     free_ffmpeg_config(data);
+    av_packet_free(&data->packet);
+    av_frame_free(&data->frame);
+
+    if (data->reader.close)
+        data->reader.close(data->reader.data);
+    av_free(data->packet_buf);
 
     if (data->header_block) {
         av_free(data->header_block);
@@ -984,7 +1065,7 @@ void free_ffmpeg(ffmpeg_codec_data* data) {
  * May need to detect exact versions if they start fixing formats.
  */
 void ffmpeg_set_skip_samples(ffmpeg_codec_data* data, int skip_samples) {
-    if (!data || !data->formatCtx || !skip_samples)
+    if (!data || (!data->formatCtx && !data->reader.read) || !skip_samples)
         return;
 
     /* let FFmpeg handle (may need an option to force override?) */
@@ -1084,7 +1165,7 @@ const char* ffmpeg_get_metadata_value(ffmpeg_codec_data* data, const char* key)
     AVDictionary* avd;
     AVDictionaryEntry* avde = NULL;
 
-    if (!data || !data->codec)
+    if (!data || !data->codec || !data->formatCtx)
         return NULL;
 
     avd = data->formatCtx->streams[data->stream_index]->metadata; /* per stream (like Ogg) */
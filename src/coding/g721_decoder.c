@@ -32,7 +32,7 @@
 #include "coding.h"
 #include "../util.h"
 
-static short power2[15] = {1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80,
+static const short power2[15] = {1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80,
                 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000};
 
 /*
@@ -46,7 +46,7 @@ static short power2[15] = {1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80,
 static int
 quan(
     int     val,
-    short   *table,
+    const short *table,
     int     size)
 {
     int     i;
@@ -405,18 +405,18 @@ update(
  * Maps G.721 code word to reconstructed scale factor normalized log
  * magnitude values.
  */
-static short    _dqlntab[16] = {-2048, 4, 135, 213, 273, 323, 373, 425,
+static const short _dqlntab[16] = {-2048, 4, 135, 213, 273, 323, 373, 425,
                 425, 373, 323, 273, 213, 135, 4, -2048};
 
 /* Maps G.721 code word to log of scale factor multiplier. */
-static short    _witab[16] = {-12, 18, 41, 64, 112, 198, 355, 1122,
+static const short _witab[16] = {-12, 18, 41, 64, 112, 198, 355, 1122,
                 1122, 355, 198, 112, 64, 41, 18, -12};
 /*
  * Maps G.721 code words to a set of values whose long and short
  * term averages are computed and then compared to give an indication
  * how stationary (steady state) the signal is.
  */
-static short    _fitab[16] = {0, 0, 0, 0x200, 0x200, 0x200, 0x600, 0xE00,
+static const short _fitab[16] = {0, 0, 0, 0x200, 0x200, 0x200, 0x600, 0xE00,
                 0xE00, 0x600, 0x200, 0x200, 0x200, 0, 0, 0};
 /*
  * g721_decoder()
@@ -1,5 +1,6 @@
 #include "coding.h"
 #include "libs/clhca.h"
+#include "../util/threads.h"
 
 
 struct hca_codec_data {
@@ -210,9 +211,42 @@ STREAMFILE* hca_get_streamfile(hca_codec_data* data) {
 #define HCA_KEY_MAX_FRAME_SCORE  600
 #define HCA_KEY_MAX_TOTAL_SCORE  (HCA_KEY_MAX_TEST_FRAMES * 50*HCA_KEY_SCORE_SCALE)
 
+static void hca_set_encryption_key_handle(void* handle, uint64_t keycode, uint64_t subkey) {
+    if (subkey) {
+        keycode = keycode * ( ((uint64_t)subkey << 16u) | ((uint16_t)~subkey + 2u) );
+    }
+    clHCA_SetKey(handle, (unsigned long long)keycode);
+}
+
+/* where test frames are read from, since keys may be tested in parallel */
+typedef struct {
+    void* handle;               /* clHCA handle used to test */
+    uint8_t* buf;               /* block_size buffer (TestBlock decrypts in place) */
+    const uint8_t* frames;      /* preloaded frames (optional) */
+    uint32_t frames_offset;
+    size_t frames_size;
+    vgm_mutex_t* sf_mutex;      /* for reads outside preloaded frames (optional) */
+} hca_keytest_io_t;
+
+static size_t read_test_frame(hca_codec_data* data, hca_keytest_io_t* io, uint32_t offset, size_t size) {
+    size_t bytes;
+
+    if (io->frames && offset >= io->frames_offset && offset + size <= io->frames_offset + io->frames_size) {
+        memcpy(io->buf, io->frames + (offset - io->frames_offset), size);
+        return size;
+    }
+
+    if (io->sf_mutex)
+        vgm_mutex_lock(io->sf_mutex);
+    bytes = read_streamfile(io->buf, offset, size, data->sf);
+    if (io->sf_mutex)
+        vgm_mutex_unlock(io->sf_mutex);
+    return bytes;
+}
+
 /* Test a number of frames if key decrypts correctly.
  * Returns score: <0: error/wrong, 0: unknown/silent file, >0: good (the closest to 1 the better). */
-static int test_hca_score(hca_codec_data* data, hca_keytest_t* hk) {
+static int test_hca_score(hca_codec_data* data, hca_keytest_io_t* io, hca_keytest_t* hk) {
     size_t test_frames = 0, current_frame = 0, blank_frames = 0;
     int total_score = 0;
     const unsigned int block_size = data->info.blockSize;
@@ -225,7 +259,7 @@ static int test_hca_score(hca_codec_data* data, hca_keytest_t* hk) {
      * Buffered IO seems fast enough (not very different reading a large block once vs frame by frame).
      * clHCA_TestBlock could be optimized a bit more. */
 
-    hca_set_encryption_key(data, hk->key, hk->subkey);
+    hca_set_encryption_key_handle(io->handle, hk->key, hk->subkey);
 
     /* Test up to N non-blank frames or until total frames. */
     /* A final score of 0 (=silent) is only possible for short files with all blank frames */
@@ -235,14 +269,14 @@ static int test_hca_score(hca_codec_data* data, hca_keytest_t* hk) {
         size_t bytes;
 
         /* read and test frame */
-        bytes = read_streamfile(data->data_buffer, offset, block_size, data->sf);
+        bytes = read_test_frame(data, io, offset, block_size);
         if (bytes != block_size) {
             /* normally this shouldn't happen, but pre-fetch ACB stop with frames in half, so just keep score */
             //total_score = -1; 
             break;
         }
 
-        score = clHCA_TestBlock(data->handle, data->data_buffer, block_size);
+        score = clHCA_TestBlock(io->handle, io->buf, block_size);
 
         /* get first non-blank frame */
         if (!hk->start_offset && score != 0) {
@@ -286,17 +320,14 @@ static int test_hca_score(hca_codec_data* data, hca_keytest_t* hk) {
         total_score = 1;
     }
 
-    clHCA_DecodeReset(data->handle);
+    clHCA_DecodeReset(io->handle);
     return total_score;
 }
 
-void test_hca_key(hca_codec_data* data, hca_keytest_t* hk) {
-    int score;
-
-    score = test_hca_score(data, hk);
+static void update_hca_key(hca_keytest_t* hk, uint64_t key, uint16_t subkey, int score) {
 
     //;VGM_LOG("HCA: test key=%08x%08x, subkey=%04x, score=%i\n",
-    //        (uint32_t)((hk->key >> 32) & 0xFFFFFFFF), (uint32_t)(hk->key & 0xFFFFFFFF), hk->subkey, score);
+    //        (uint32_t)((key >> 32) & 0xFFFFFFFF), (uint32_t)(key & 0xFFFFFFFF), subkey, score);
 
     /* wrong key */
     if (score < 0)
@@ -305,13 +336,245 @@ void test_hca_key(hca_codec_data* data, hca_keytest_t* hk) {
     /* update if something better is found */
     if (hk->best_score <= 0 || (score < hk->best_score && score > 0)) {
         hk->best_score = score;
-        hk->best_key = hk->key; /* base */
+        hk->best_key = key; /* base */
+        hk->best_subkey = subkey;
     }
 }
 
-void hca_set_encryption_key(hca_codec_data* data, uint64_t keycode, uint64_t subkey) {
-    if (subkey) {
-        keycode = keycode * ( ((uint64_t)subkey << 16u) | ((uint16_t)~subkey + 2u) );
+void test_hca_key(hca_codec_data* data, hca_keytest_t* hk) {
+    hca_keytest_io_t io = {0};
+    int score;
+
+    io.handle = data->handle;
+    io.buf = data->data_buffer;
+
+    score = test_hca_score(data, &io, hk);
+    update_hca_key(hk, hk->key, hk->subkey, score);
+}
+
+
+/* Parallel key tests: each worker has its own clHCA handle and takes keys in list order from a shared
+ * position, saving scores. Once a key gets a perfect score later keys are skipped, and results are
+ * evaluated in order at the end, so the chosen key is the same as testing one by one. */
+
+/* min keys to bother with threads (few keys are quick enough) */
+#define HCA_KEYS_MIN_PARALLEL    64
+/* keys taken per lock */
+#define HCA_KEYS_PER_TAKE        8
+/* frames preloaded for all workers (most keys fail in the first few) */
+#define HCA_KEYS_PRELOAD_FRAMES  (HCA_KEY_MAX_TEST_FRAMES * 4)
+#define HCA_KEYS_MAX_THREADS     16
+
+typedef struct {
+    hca_codec_data* data;
+    const hca_keytest_t* hk;
+    const uint64_t* keys;
+    const uint16_t* subkeys;
+    int* scores;
+    hca_keytest_io_t* io;       /* per worker */
+
+    vgm_mutex_t* mutex;
+    int next;                   /* next key to take */
+    int stop;                   /* first key with perfect score (keys_count if none) */
+} hca_keys_ctx_t;
+
+static void test_hca_keys_worker(void* ctx_, int index) {
+    hca_keys_ctx_t* ctx = ctx_;
+    hca_keytest_io_t* io = &ctx->io[index];
+    hca_keytest_t hk = *ctx->hk;
+
+    while (true) {
+        int i, start, end;
+
+        vgm_mutex_lock(ctx->mutex);
+        start = ctx->next;
+        end = start + HCA_KEYS_PER_TAKE;
+        if (end > ctx->stop)
+            end = ctx->stop;
+        if (start < end)
+            ctx->next = end;
+        vgm_mutex_unlock(ctx->mutex);
+
+        if (start >= end)
+            break;
+
+        for (i = start; i < end; i++) {
+            int score, stop;
+
+            /* lower keys are always taken first, so a perfect score only needs to cancel higher keys */
+            vgm_mutex_lock(ctx->mutex);
+            stop = ctx->stop;
+            vgm_mutex_unlock(ctx->mutex);
+            if (i > stop)
+                break;
+
+            hk.key = ctx->keys[i];
+            if (ctx->subkeys)
+                hk.subkey = ctx->subkeys[i];
+            score = test_hca_score(ctx->data, io, &hk);
+            ctx->scores[i] = score;
+
+            if (score == 1) {
+                vgm_mutex_lock(ctx->mutex);
+                if (ctx->stop > i)
+                    ctx->stop = i;
+                vgm_mutex_unlock(ctx->mutex);
+                break;
+            }
+        }
     }
-    clHCA_SetKey(data->handle, (unsigned long long)keycode);
+}
+
+static bool test_hca_keys_parallel(hca_codec_data* data, hca_keytest_t* hk, const uint64_t* keys, const uint16_t* subkeys, int keys_count, int threads) {
+    vgm_pool_t* pool = NULL;
+    hca_keys_ctx_t ctx = {0};
+    uint8_t* header = NULL;
+    uint8_t* frames = NULL;
+    int i;
+    bool ok = false;
+
+    if (threads > HCA_KEYS_MAX_THREADS)
+        threads = HCA_KEYS_MAX_THREADS;
+    if (!vgm_threads_available() || threads < 2 || keys_count < HCA_KEYS_MIN_PARALLEL)
+        return false;
+
+    /* first key is tested normally to find the first non-blank frame, that other keys start from */
+    {
+        hca_keytest_t hk_first = *hk;
+        hca_keytest_io_t io = {0};
+        int score;
+
+        io.handle = data->handle;
+        io.buf = data->data_buffer;
+
+        hk_first.key = keys[0];
+        if (subkeys)
+            hk_first.subkey = subkeys[0];
+        score = test_hca_score(data, &io, &hk_first);
+
+        if (!hk_first.start_offset) /* all blank so far, let other keys find it in order */
+            return false;
+        hk->start_offset = hk_first.start_offset;
+
+        if (score == 1) {
+            update_hca_key(hk, hk_first.key, hk_first.subkey, score);
+            return true;
+        }
+
+        ctx.stop = keys_count;
+        ctx.scores = calloc(keys_count, sizeof(int));
+        if (!ctx.scores) goto fail;
+        ctx.scores[0] = score;
+    }
+
+    pool = vgm_pool_init(threads);
+    if (!pool) goto fail;
+    threads = vgm_pool_get_threads(pool);
+
+    ctx.mutex = vgm_mutex_init();
+    if (!ctx.mutex) goto fail;
+
+    /* shared frames */
+    {
+        uint32_t offset = hk->start_offset;
+        size_t size = data->info.blockSize * HCA_KEYS_PRELOAD_FRAMES;
+        size_t max_size = get_streamfile_size(data->sf);
+
+        if (offset >= max_size) goto fail;
+        if (size > max_size - offset)
+            size = max_size - offset;
+
+        frames = malloc(size);
+        if (!frames) goto fail;
+        size = read_streamfile(frames, offset, size, data->sf);
+
+        ctx.io = calloc(threads, sizeof(hca_keytest_io_t));
+        if (!ctx.io) goto fail;
+
+        for (i = 0; i < threads; i++) {
+            ctx.io[i].frames = frames;
+            ctx.io[i].frames_offset = offset;
+            ctx.io[i].frames_size = size;
+            ctx.io[i].sf_mutex = ctx.mutex;
+        }
+    }
+
+    /* per worker handles, from the same header */
+    {
+        unsigned int header_size = data->info.headerSize;
+
+        header = malloc(header_size);
+        if (!header) goto fail;
+        if (read_streamfile(header, 0x00, header_size, data->sf) != header_size)
+            goto fail;
+
+        for (i = 0; i < threads; i++) {
+            hca_keytest_io_t* io = &ctx.io[i];
+
+            io->buf = malloc(data->info.blockSize);
+            io->handle = calloc(1, clHCA_sizeof());
+            if (!io->buf || !io->handle) goto fail;
+
+            clHCA_clear(io->handle);
+            if (clHCA_DecodeHeader(io->handle, header, header_size) < 0)
+                goto fail;
+        }
+    }
+
+    ctx.data = data;
+    ctx.hk = hk;
+    ctx.keys = keys;
+    ctx.subkeys = subkeys;
+    ctx.next = 1;
+
+    vgm_pool_run(pool, threads, test_hca_keys_worker, &ctx);
+
+    /* all keys up to the first perfect score were tested, apply in the same order as one by one */
+    for (i = 0; i < keys_count; i++) {
+        update_hca_key(hk, keys[i], subkeys ? subkeys[i] : hk->subkey, ctx.scores[i]);
+        if (hk->best_score == 1)
+            break;
+    }
+
+    ok = true;
+fail:
+    if (ctx.io) {
+        for (i = 0; i < threads; i++) {
+            if (ctx.io[i].handle)
+                clHCA_done(ctx.io[i].handle);
+            free(ctx.io[i].handle);
+            free(ctx.io[i].buf);
+        }
+        free(ctx.io);
+    }
+    free(header);
+    free(frames);
+    free(ctx.scores);
+    vgm_mutex_free(ctx.mutex);
+    vgm_pool_free(pool);
+    return ok;
+}
+
+void test_hca_keys(hca_codec_data* data, hca_keytest_t* hk, const uint64_t* keys, const uint16_t* subkeys, int keys_count, int threads) {
+    int i;
+
+    if (keys_count <= 0)
+        return;
+
+    if (test_hca_keys_parallel(data, hk, keys, subkeys, keys_count, threads))
+        return;
+
+    for (i = 0; i < keys_count; i++) {
+        hk->key = keys[i];
+        if (subkeys)
+            hk->subkey = subkeys[i];
+
+        test_hca_key(data, hk);
+        if (hk->best_score == 1)
+            break;
+    }
+}
+
+void hca_set_encryption_key(hca_codec_data* data, uint64_t keycode, uint64_t subkey) {
+    hca_set_encryption_key_handle(data->handle, keycode, subkey);
 }
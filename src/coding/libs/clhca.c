@@ -30,6 +30,31 @@
 #include <stdlib.h>
 #include <memory.h>
 
+/* Optional 4-float SIMD (SSE2) for the transform loops, with the same operation order as the scalar code
+ * so output doesn't change (checked by test/clhca_test.c). Skipped when the target has FMA, as compilers
+ * may then contract the scalar a*b+c into fused ops and SIMD output would differ: that includes NEON
+ * (always FMA on ARM64), left out until it can be verified on hardware. Define HCA_DISABLE_SIMD to use plain C. */
+#if !defined(HCA_DISABLE_SIMD) && !defined(__FMA__) && !defined(__AVX2__)
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define HCA_SIMD 1
+    typedef __m128 hca_v4;
+    #define hv_load(p)          _mm_loadu_ps(p)
+    #define hv_store(p, v)      _mm_storeu_ps(p, v)
+    #define hv_add(a, b)        _mm_add_ps(a, b)
+    #define hv_sub(a, b)        _mm_sub_ps(a, b)
+    #define hv_mul(a, b)        _mm_mul_ps(a, b)
+    #define hv_reverse(v)       _mm_shuffle_ps(v, v, _MM_SHUFFLE(0,1,2,3))
+    /* p = a0 b0 a1 b1 a2 b2 a3 b3 > a = a0..a3, b = b0..b3 */
+    #define hv_load_deinterleave(p, a, b) do { \
+            __m128 v0_ = _mm_loadu_ps((p) + 0); \
+            __m128 v1_ = _mm_loadu_ps((p) + 4); \
+            a = _mm_shuffle_ps(v0_, v1_, _MM_SHUFFLE(2,0,2,0)); \
+            b = _mm_shuffle_ps(v0_, v1_, _MM_SHUFFLE(3,1,3,1)); \
+        } while (0)
+  #endif
+#endif
+
 /* CRI libs may only accept last version in some cases/modes, though most decoding takes older versions
  * into account. Lib is identified with "HCA Decoder (Float)" + version string. Some known versions:
  * - ~V1.1 2011 [first public version]
@@ -1555,8 +1580,23 @@ static void dequantize_coefficients(stChannel* ch, clData* br, int subframe) {
             qc = hcatbdecoder_read_val_table[index];
         }
 
-        /* dequantize coef with gain */
-        ch->spectra[subframe][i] = ch->gain[i] * qc;
+        ch->spectra[subframe][i] = qc;
+    }
+
+    /* dequantize coefs with gain (separate from the bitreader so it's vectorizable) */
+    {
+        float* spectra = ch->spectra[subframe];
+        const float* gain = ch->gain;
+
+        i = 0;
+#ifdef HCA_SIMD
+        for (; i + 4 <= cc_count; i += 4) {
+            hv_store(&spectra[i], hv_mul(hv_load(&gain[i]), hv_load(&spectra[i])));
+        }
+#endif
+        for (; i < cc_count; i++) {
+            spectra[i] = gain[i] * spectra[i];
+        }
     }
 
     /* clean rest of spectra */
@@ -1909,7 +1949,19 @@ static void imdct_transform(stChannel* ch, int subframe) {
             float* d2 = &temp2[count2];
 
             for (j = 0; j < count1; j++) {
-                for (k = 0; k < count2; k++) {
+                k = 0;
+#ifdef HCA_SIMD
+                for (; k + 4 <= count2; k += 4) {
+                    hca_v4 a, b;
+                    hv_load_deinterleave(temp1, a, b);
+                    hv_store(d1, hv_add(a, b));
+                    hv_store(d2, hv_sub(a, b));
+                    temp1 += 8;
+                    d1 += 4;
+                    d2 += 4;
+                }
+#endif
+                for (; k < count2; k++) {
                     float a = *(temp1++);
                     float b = *(temp1++);
                     *(d1++) = a + b;
@@ -1943,7 +1995,24 @@ static void imdct_transform(stChannel* ch, int subframe) {
             const float* s2 = &temp1[count2];
 
             for (j = 0; j < count1; j++) {
-                for (k = 0; k < count2; k++) {
+                k = 0;
+#ifdef HCA_SIMD
+                for (; k + 4 <= count2; k += 4) {
+                    hca_v4 a = hv_load(s1);
+                    hca_v4 b = hv_load(s2);
+                    hca_v4 sin = hv_load(sin_table);
+                    hca_v4 cos = hv_load(cos_table);
+                    hv_store(d1, hv_sub(hv_mul(a, sin), hv_mul(b, cos)));
+                    hv_store(d2 - 3, hv_reverse(hv_add(hv_mul(a, cos), hv_mul(b, sin)))); /* d2 goes backwards */
+                    s1 += 4;
+                    s2 += 4;
+                    sin_table += 4;
+                    cos_table += 4;
+                    d1 += 4;
+                    d2 -= 4;
+                }
+#endif
+                for (; k < count2; k++) {
                     float a = *(s1++);
                     float b = *(s2++);
                     float sin = *(sin_table++);
@@ -1977,12 +2046,35 @@ static void imdct_transform(stChannel* ch, int subframe) {
         const float* dct = &ch->spectra[subframe][0]; //ch->dct;
         const float* prev = &ch->imdct_previous[0];
 
+#ifdef HCA_SIMD
+        {
+            const float* window = hcaimdct_window_float;
+            float* wave = ch->wave[subframe];
+            float* next = ch->imdct_previous;
+
+            /* half is a multiple of 4, no tail needed; reversed reads load the 4 floats ending at the index, then reverse */
+            for (i = 0; i < half; i += 4) {
+                hca_v4 prev_lo = hv_load(&prev[i]);
+                hca_v4 prev_hi = hv_load(&prev[i + half]);
+                hca_v4 dct_lo = hv_load(&dct[i]);
+                hca_v4 dct_hi = hv_load(&dct[i + half]);
+                hca_v4 dct_hi_rev = hv_reverse(hv_load(&dct[size - 4 - i]));
+                hca_v4 dct_lo_rev = hv_load(&dct[half - 4 - i]);
+
+                hv_store(&wave[i], hv_add(hv_mul(hv_load(&window[i]), dct_hi), prev_lo));
+                hv_store(&wave[i + half], hv_sub(hv_mul(hv_load(&window[i + half]), dct_hi_rev), prev_hi));
+                hv_store(&next[i], hv_reverse(hv_mul(hv_load(&window[size - 4 - i]), dct_lo_rev)));
+                hv_store(&next[i + half], hv_mul(hv_reverse(hv_load(&window[half - 4 - i])), dct_lo));
+            }
+        }
+#else
         for (i = 0; i < half; i++) {
             ch->wave[subframe][i] = hcaimdct_window_float[i] * dct[i + half] + prev[i];
             ch->wave[subframe][i + half] = hcaimdct_window_float[i + half] * dct[size - 1 - i] - prev[i + half];
             ch->imdct_previous[i] = hcaimdct_window_float[size - 1 - i] * dct[half - i - 1];
             ch->imdct_previous[i + half] = hcaimdct_window_float[half - i - 1] * dct[i];
         }
+#endif
 #if 0
         /* over-optimized IMDCT window (for reference), barely noticeable even when decoding hundred of files */
         const float* imdct_window = hcaimdct_window_float;
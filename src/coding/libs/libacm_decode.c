@@ -169,32 +169,42 @@ static const int map_1bit[] = { -1, +1 };
 static const int map_2bit_near[] = { -2, -1, +1, +2 };
 static const int map_2bit_far[] = { -3, -2, +2, +3 };
 static const int map_3bit[] = { -4, -3, -2, -1, +1, +2, +3, +4 };
-static int mul_3x3[3*3*3];
-static int mul_3x5[5*5*5]; 
-static int mul_2x11[11*11];
-static int tables_generated;
-
-static void generate_tables(void)
-{
-	int x1, x2, x3;
-	if (tables_generated)
-		return;
-	for (x3 = 0; x3 < 3; x3++)
-		for (x2 = 0; x2 < 3; x2++)
-			for (x1 = 0; x1 < 3; x1++)
-				mul_3x3[x1 + x2*3 + x3*3*3] = 
-					x1 + (x2 << 4) + (x3 << 8);
-	for (x3 = 0; x3 < 5; x3++)
-		for (x2 = 0; x2 < 5; x2++)
-			for (x1 = 0; x1 < 5; x1++)
-				mul_3x5[x1 + x2*5 + x3*5*5] = 
-					x1 + (x2 << 4) + (x3 << 8);
-	for (x2 = 0; x2 < 11; x2++)
-		for (x1 = 0; x1 < 11; x1++)
-			mul_2x11[x1 + x2*11] = x1 + (x2 << 4);
-
-	tables_generated = 1;
-}
+/* precalculated rather than generated on first use (not thread-safe):
+ * mul_3x3[x1 + x2*3 + x3*3*3] = x1 + (x2 << 4) + (x3 << 8), same for 3x5, and mul_2x11[x1 + x2*11] = x1 + (x2 << 4) */
+static const int mul_3x3[3*3*3] = {
+	0x000, 0x001, 0x002, 0x010, 0x011, 0x012, 0x020, 0x021, 0x022,
+	0x100, 0x101, 0x102, 0x110, 0x111, 0x112, 0x120, 0x121, 0x122,
+	0x200, 0x201, 0x202, 0x210, 0x211, 0x212, 0x220, 0x221, 0x222,
+};
+static const int mul_3x5[5*5*5] = {
+	0x000, 0x001, 0x002, 0x003, 0x004, 0x010, 0x011, 0x012, 0x013,
+	0x014, 0x020, 0x021, 0x022, 0x023, 0x024, 0x030, 0x031, 0x032,
+	0x033, 0x034, 0x040, 0x041, 0x042, 0x043, 0x044, 0x100, 0x101,
+	0x102, 0x103, 0x104, 0x110, 0x111, 0x112, 0x113, 0x114, 0x120,
+	0x121, 0x122, 0x123, 0x124, 0x130, 0x131, 0x132, 0x133, 0x134,
+	0x140, 0x141, 0x142, 0x143, 0x144, 0x200, 0x201, 0x202, 0x203,
+	0x204, 0x210, 0x211, 0x212, 0x213, 0x214, 0x220, 0x221, 0x222,
+	0x223, 0x224, 0x230, 0x231, 0x232, 0x233, 0x234, 0x240, 0x241,
+	0x242, 0x243, 0x244, 0x300, 0x301, 0x302, 0x303, 0x304, 0x310,
+	0x311, 0x312, 0x313, 0x314, 0x320, 0x321, 0x322, 0x323, 0x324,
+	0x330, 0x331, 0x332, 0x333, 0x334, 0x340, 0x341, 0x342, 0x343,
+	0x344, 0x400, 0x401, 0x402, 0x403, 0x404, 0x410, 0x411, 0x412,
+	0x413, 0x414, 0x420, 0x421, 0x422, 0x423, 0x424, 0x430, 0x431,
+	0x432, 0x433, 0x434, 0x440, 0x441, 0x442, 0x443, 0x444,
+};
+static const int mul_2x11[11*11] = {
+	0x000, 0x001, 0x002, 0x003, 0x004, 0x005, 0x006, 0x007, 0x008, 0x009, 0x00A,
+	0x010, 0x011, 0x012, 0x013, 0x014, 0x015, 0x016, 0x017, 0x018, 0x019, 0x01A,
+	0x020, 0x021, 0x022, 0x023, 0x024, 0x025, 0x026, 0x027, 0x028, 0x029, 0x02A,
+	0x030, 0x031, 0x032, 0x033, 0x034, 0x035, 0x036, 0x037, 0x038, 0x039, 0x03A,
+	0x040, 0x041, 0x042, 0x043, 0x044, 0x045, 0x046, 0x047, 0x048, 0x049, 0x04A,
+	0x050, 0x051, 0x052, 0x053, 0x054, 0x055, 0x056, 0x057, 0x058, 0x059, 0x05A,
+	0x060, 0x061, 0x062, 0x063, 0x064, 0x065, 0x066, 0x067, 0x068, 0x069, 0x06A,
+	0x070, 0x071, 0x072, 0x073, 0x074, 0x075, 0x076, 0x077, 0x078, 0x079, 0x07A,
+	0x080, 0x081, 0x082, 0x083, 0x084, 0x085, 0x086, 0x087, 0x088, 0x089, 0x08A,
+	0x090, 0x091, 0x092, 0x093, 0x094, 0x095, 0x096, 0x097, 0x098, 0x099, 0x09A,
+	0x0A0, 0x0A1, 0x0A2, 0x0A3, 0x0A4, 0x0A5, 0x0A6, 0x0A7, 0x0A8, 0x0A9, 0x0AA,
+};
 
 /* IOW: (r * acm->subblock_len) + c */
 #define set_pos(acm, r, c, idx) do { \
@@ -827,8 +837,6 @@ int acm_open_decoder(ACMStream **res, void *arg, acm_io_callbacks io_cb, int for
 
 	memset(acm->wrapbuf, 0, acm->wrapbuf_len * sizeof(int));
 
-	generate_tables();
-
 	*res = acm;
 	return ACM_OK;
 
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <math.h>
 #include "relic_lib.h"
+#include "../../util/threads.h"
 
 /* Relic Codec decoder, a fairly simple mono-interleave DCT-based codec.
  *
@@ -11,7 +12,10 @@
  */
 
 /* mixfft.c */
+typedef struct relic_mixfft_plan_t relic_mixfft_plan_t;
 extern void relic_mixfft_fft(int n, float* xRe, float* xIm, float* yRe, float* yIm);
+extern relic_mixfft_plan_t* relic_mixfft_plan_init(int n);
+extern void relic_mixfft_fft_plan(const relic_mixfft_plan_t* plan, const float* xRe, const float* xIm, float* yRe, float* yIm);
 
 
 #define RELIC_MAX_CHANNELS  2
@@ -43,6 +47,7 @@ struct relic_handle_t {
     float scales[RELIC_MAX_SCALES]; /* quantization scales */
     float dct[RELIC_MAX_SIZE];
     float window[RELIC_MAX_SIZE];
+    const relic_mixfft_plan_t* fft_plans[3]; /* per DCT size (shared) */
     /* decoder frame state */
     uint8_t exponents[RELIC_MAX_CHANNELS][RELIC_MAX_FREQ]; /* quantization/scale indexes */
     float freq1[RELIC_MAX_FREQ]; /* dequantized spectrum */
@@ -60,6 +65,31 @@ static const int16_t critical_band_data[RELIC_CRITICAL_BAND_COUNT] = {
     139, 180, 256
 };
 
+/* FFT plans for each DCT size (low/mid/high), made on first use and shared between handles (never freed) */
+static relic_mixfft_plan_t* g_fft_plans[3];
+
+static void init_fft_plans(const relic_mixfft_plan_t** plans) {
+    static const int dct_sizes[3] = { RELIC_SIZE_LOW, RELIC_SIZE_MID, RELIC_SIZE_HIGH };
+    int i;
+
+    vgm_global_lock();
+    for (i = 0; i < 3; i++) {
+        if (!g_fft_plans[i])
+            g_fft_plans[i] = relic_mixfft_plan_init(dct_sizes[i] >> 2);
+        plans[i] = g_fft_plans[i]; /* may be NULL on alloc errors, then generic FFT is used */
+    }
+    vgm_global_unlock();
+}
+
+static const relic_mixfft_plan_t* get_fft_plan(const relic_mixfft_plan_t* const* plans, int dct_size) {
+    switch(dct_size) {
+        case RELIC_SIZE_LOW:  return plans[0];
+        case RELIC_SIZE_MID:  return plans[1];
+        case RELIC_SIZE_HIGH: return plans[2];
+        default: return NULL;
+    }
+}
+
 static void init_dct(float* dct, int dct_size) {
     int i;
     int dct_quarter = dct_size >> 2;
@@ -71,7 +101,7 @@ static void init_dct(float* dct, int dct_size) {
     }
 }
 
-static int apply_idct(const float* freq, float* wave, const float* dct, int dct_size) {
+static int apply_idct(const float* freq, float* wave, const float* dct, int dct_size, const relic_mixfft_plan_t* plan) {
     int i;
     float factor;
     float out_re[RELIC_MAX_FFT];
@@ -92,7 +122,10 @@ static int apply_idct(const float* freq, float* wave, const float* dct, int dct_
     }
 
     /* main FFT */
-    relic_mixfft_fft(dct_quarter, in_re, in_im, out_re, out_im);
+    if (plan)
+        relic_mixfft_fft_plan(plan, in_re, in_im, out_re, out_im);
+    else
+        relic_mixfft_fft(dct_quarter, in_re, in_im, out_re, out_im);
 
     /* postrotation, window and reorder? */
     factor = 8.0 / sqrt(dct_size);
@@ -117,17 +150,18 @@ static int apply_idct(const float* freq, float* wave, const float* dct, int dct_
     return 0;
 }
 
-static void decode_frame(const float* freq1, const float* freq2, float* wave_cur, float* wave_prv, const float* dct, const float* window, int dct_size) {
+static void decode_frame(const float* freq1, const float* freq2, float* wave_cur, float* wave_prv, const float* dct, const float* window, int dct_size, const relic_mixfft_plan_t* const* plans) {
     int i;
     float wave_tmp[RELIC_MAX_SIZE];
     int dct_half = dct_size >> 1;
+    const relic_mixfft_plan_t* plan = get_fft_plan(plans, dct_size);
 
     /* copy for first half(?) */
     memcpy(wave_cur, wave_prv, RELIC_MAX_SIZE * sizeof(float));
 
     /* transform frequency domain to time domain with DCT/FFT */
-    apply_idct(freq1, wave_tmp, dct, dct_size);
-    apply_idct(freq2, wave_prv, dct, dct_size);
+    apply_idct(freq1, wave_tmp, dct, dct_size, plan);
+    apply_idct(freq2, wave_prv, dct, dct_size, plan);
 
     /* overlap and apply window function to filter this block's beginning */
     for (i = 0; i < dct_half; i++) {
@@ -144,7 +178,7 @@ static void init_window(float *window, int dct_size) {
     }
 }
 
-static void decode_frame_base(const float* freq1, const float* freq2, float* wave_cur, float* wave_prv, const float* dct, const float* window, int dct_mode, int samples_mode) {
+static void decode_frame_base(const float* freq1, const float* freq2, float* wave_cur, float* wave_prv, const float* dct, const float* window, int dct_mode, int samples_mode, const relic_mixfft_plan_t* const* plans) {
     int i;
     float wave_tmp[RELIC_MAX_SIZE];
 
@@ -153,13 +187,13 @@ static void decode_frame_base(const float* freq1, const float* freq2, float* wav
     if (samples_mode == RELIC_SIZE_LOW) {
         {
             /* 128 DCT to 128 samples */
-            decode_frame(freq1, freq2, wave_cur, wave_prv, dct, window, RELIC_SIZE_LOW);
+            decode_frame(freq1, freq2, wave_cur, wave_prv, dct, window, RELIC_SIZE_LOW, plans);
         }
     }
     else if (samples_mode == RELIC_SIZE_MID) {
         if (dct_mode == RELIC_SIZE_LOW) { 
             /* 128 DCT to 256 samples (repeat sample x2) */
-            decode_frame(freq1, freq2, wave_tmp, wave_prv, dct, window, RELIC_SIZE_LOW);
+            decode_frame(freq1, freq2, wave_tmp, wave_prv, dct, window, RELIC_SIZE_LOW, plans);
             for (i = 0; i < 256 - 1; i += 2) {
                 wave_cur[i + 0] = wave_tmp[i >> 1];
                 wave_cur[i + 1] = wave_tmp[i >> 1];
@@ -167,13 +201,13 @@ static void decode_frame_base(const float* freq1, const float* freq2, float* wav
         }
         else {
             /* 256 DCT to 256 samples */
-            decode_frame(freq1, freq2, wave_cur, wave_prv, dct, window, RELIC_SIZE_MID);
+            decode_frame(freq1, freq2, wave_cur, wave_prv, dct, window, RELIC_SIZE_MID, plans);
         }
     }
     else if (samples_mode == RELIC_SIZE_HIGH) {
         if (dct_mode == RELIC_SIZE_LOW) {
             /* 128 DCT to 512 samples (repeat sample x4) */
-            decode_frame(freq1, freq2, wave_tmp, wave_prv, dct, window, RELIC_SIZE_LOW);
+            decode_frame(freq1, freq2, wave_tmp, wave_prv, dct, window, RELIC_SIZE_LOW, plans);
             for (i = 0; i < 512 - 1; i += 4) {
                 wave_cur[i + 0] = wave_tmp[i >> 2];
                 wave_cur[i + 1] = wave_tmp[i >> 2];
@@ -183,7 +217,7 @@ static void decode_frame_base(const float* freq1, const float* freq2, float* wav
         }
         else if (dct_mode == RELIC_SIZE_MID) {
             /* 256 DCT to 512 samples (repeat sample x2) */
-            decode_frame(freq1, freq2, wave_tmp, wave_prv, dct, window, RELIC_SIZE_MID);
+            decode_frame(freq1, freq2, wave_tmp, wave_prv, dct, window, RELIC_SIZE_MID, plans);
             for (i = 0; i < 512 - 1; i += 2) {
                 wave_cur[i + 0] = wave_tmp[i >> 1];
                 wave_cur[i + 1] = wave_tmp[i >> 1];
@@ -191,7 +225,7 @@ static void decode_frame_base(const float* freq1, const float* freq2, float* wav
         }
         else {
             /* 512 DCT to 512 samples */
-            decode_frame(freq1, freq2, wave_cur, wave_prv, dct, window, RELIC_SIZE_HIGH);
+            decode_frame(freq1, freq2, wave_cur, wave_prv, dct, window, RELIC_SIZE_HIGH, plans);
         }
     }
 }
@@ -380,6 +414,7 @@ relic_handle_t* relic_init(int channels, int bitrate, int codec_rate) {
     handle->samples_mode = RELIC_SIZE_HIGH;
 
     init_dct(handle->dct, RELIC_SIZE_HIGH);
+    init_fft_plans(handle->fft_plans);
     init_window(handle->window, RELIC_SIZE_HIGH);
     init_dequantization(handle->scales);
     memset(handle->wave_prv, 0, RELIC_MAX_CHANNELS * RELIC_MAX_SIZE * sizeof(float));
@@ -421,7 +456,7 @@ int relic_decode_frame(relic_handle_t* handle, uint8_t* buf, int channel) {
     ok = unpack_frame(buf, RELIC_BUFFER_SIZE, handle->freq1, handle->freq2, handle->scales, handle->exponents[channel], handle->freq_size);
     if (!ok) return ok;
 
-    decode_frame_base(handle->freq1, handle->freq2, handle->wave_cur[channel], handle->wave_prv[channel], handle->dct, handle->window, handle->dct_mode, handle->samples_mode);
+    decode_frame_base(handle->freq1, handle->freq2, handle->wave_cur[channel], handle->wave_prv[channel], handle->dct, handle->window, handle->dct_mode, handle->samples_mode, handle->fft_plans);
 
     return 1;
 }
@@ -436,17 +471,25 @@ void relic_get_pcm16(relic_handle_t* handle, int16_t* outbuf, int32_t samples, i
     int s, ch;
     int ichs = handle->channels;
 
-    for (ch = 0; ch < ichs; ch++) {
-        for (s = 0; s < samples; s++) {
-            double d64_sample = handle->wave_cur[ch][skip + s];
-            int pcm_sample = clamp16((int32_t)d64_sample);
+    /* f32 in PCM 32767.0 .. -32768.0 format, original code does some custom double-to-int rint() though
+     * (truncating from float directly is the same as through double for valid values) */
+    //FQ_BNUM ((float)(1<<26)*(1<<26)*1.5)
+    //rint(x) ((d64 = (double)(x)+FQ_BNUM), *(int*)(&d64))
 
-            /* f32 in PCM 32767.0 .. -32768.0 format, original code
-             * does some custom double-to-int rint() though */
-            //FQ_BNUM ((float)(1<<26)*(1<<26)*1.5)
-            //rint(x) ((d64 = (double)(x)+FQ_BNUM), *(int*)(&d64))
+    if (ichs == 2) {
+        const float* wave_l = handle->wave_cur[0] + skip;
+        const float* wave_r = handle->wave_cur[1] + skip;
+        for (s = 0; s < samples; s++) {
+            outbuf[s*2 + 0] = clamp16((int32_t)wave_l[s]);
+            outbuf[s*2 + 1] = clamp16((int32_t)wave_r[s]);
+        }
+        return;
+    }
 
-            outbuf[s*ichs + ch] = pcm_sample;
+    for (ch = 0; ch < ichs; ch++) {
+        const float* wave = handle->wave_cur[ch] + skip;
+        for (s = 0; s < samples; s++) {
+            outbuf[s*ichs + ch] = clamp16((int32_t)wave[s]);
         }
     }
 }
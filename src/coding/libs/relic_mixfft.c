@@ -616,3 +616,386 @@ static void twiddleTransf(int sofarRadix, int radix, int remainRadix,
 }   /* fft */
 
 
+
+
+/* ------------------------------------------------------------------------- */
+
+/* extra: precomputed plans (not in the original code).
+ * Relic only calls the FFT with a few fixed sizes, so factors, permutation and twiddles can be made once
+ * (using the same float ops as above, so results don't change). Stages with radix 2/4/8 also handle 4
+ * consecutive twiddle indexes at once with SIMD, as their data is contiguous. */
+
+#if !defined(RELIC_DISABLE_SIMD)
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define RELIC_SIMD 1
+    typedef __m128 rv4;
+    #define rv_load(p)      _mm_loadu_ps(p)
+    #define rv_store(p, v)  _mm_storeu_ps(p, v)
+    #define rv_set1(f)      _mm_set1_ps(f)
+    #define rv_add(a, b)    _mm_add_ps(a, b)
+    #define rv_sub(a, b)    _mm_sub_ps(a, b)
+    #define rv_mul(a, b)    _mm_mul_ps(a, b)
+    #define rv_neg(a)       _mm_xor_ps(a, _mm_set1_ps(-0.0f))
+  #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define RELIC_SIMD 1
+    typedef float32x4_t rv4;
+    #define rv_load(p)      vld1q_f32(p)
+    #define rv_store(p, v)  vst1q_f32(p, v)
+    #define rv_set1(f)      vdupq_n_f32(f)
+    #define rv_add(a, b)    vaddq_f32(a, b)
+    #define rv_sub(a, b)    vsubq_f32(a, b)
+    #define rv_mul(a, b)    vmulq_f32(a, b)
+    #define rv_neg(a)       vnegq_f32(a)
+  #endif
+#endif
+
+typedef struct relic_mixfft_plan_t {
+    int     n;
+    int     nFactor;
+    int     sofarRadix[maxFactorCount];
+    int     actualRadix[maxFactorCount];
+    int     remainRadix[maxFactorCount];
+    int*    index;                          /* permutation (y[i] = x[index[i]]) */
+    float*  twiddleRe[maxFactorCount];      /* per stage, as [blockNo * sofarRadix + dataNo] */
+    float*  twiddleIm[maxFactorCount];
+    float   trigRe[maxFactorCount][maxPrimeFactor];
+    float   trigIm[maxFactorCount][maxPrimeFactor];
+} relic_mixfft_plan_t;
+
+void relic_mixfft_plan_free(relic_mixfft_plan_t* plan);
+
+/* same as permute() but saving source indexes */
+static void setupIndex(relic_mixfft_plan_t* plan)
+{
+    int i,j,k;
+    int count[maxFactorCount] = {0};
+    int* fact = plan->actualRadix;
+    int* remain = plan->remainRadix;
+
+    k=0;
+    for (i=0; i<=plan->n-2; i++)
+    {
+        plan->index[i] = k;
+        j=1;
+        k=k+remain[j];
+        count[1] = count[1]+1;
+        while (count[j] >= fact[j])
+        {
+            count[j]=0;
+            k=k-remain[j-1]+remain[j+1];
+            j=j+1;
+            count[j]=count[j]+1;
+        }
+    }
+    plan->index[plan->n-1] = plan->n-1;
+}
+
+/* same twiddles that twiddleTransf() calculates on every call */
+static void setupTwiddles(int sofarRadix, int radix, float* outRe, float* outIm)
+{
+    float   cosw, sinw, gem;
+    float   omega, tw_re,tw_im;
+    float   twiddleRe[maxPrimeFactor] = {0}, twiddleIm[maxPrimeFactor] = {0};
+    int     dataNo,twNo;
+
+    omega = 2*pi/(double)(sofarRadix*radix);
+    cosw =  cos(omega);
+    sinw = -sin(omega);
+    tw_re = 1.0;
+    tw_im = 0;
+    for (dataNo=0; dataNo<sofarRadix; dataNo++)
+    {
+        twiddleRe[0] = 1.0;
+        twiddleIm[0] = 0.0;
+        twiddleRe[1] = tw_re;
+        twiddleIm[1] = tw_im;
+        for (twNo=2; twNo<radix; twNo++)
+        {
+            twiddleRe[twNo]=tw_re*twiddleRe[twNo-1]
+                           - tw_im*twiddleIm[twNo-1];
+            twiddleIm[twNo]=tw_im*twiddleRe[twNo-1]
+                           + tw_re*twiddleIm[twNo-1];
+        }
+        gem   = cosw*tw_re - sinw*tw_im;
+        tw_im = sinw*tw_re + cosw*tw_im;
+        tw_re = gem;
+
+        for (twNo=0; twNo<radix; twNo++)
+        {
+            outRe[twNo*sofarRadix + dataNo] = twiddleRe[twNo];
+            outIm[twNo*sofarRadix + dataNo] = twiddleIm[twNo];
+        }
+    }
+}
+
+relic_mixfft_plan_t* relic_mixfft_plan_init(int n)
+{
+    relic_mixfft_plan_t* plan;
+    int count;
+
+    if (n <= 0)
+        return NULL;
+
+    plan = calloc(1, sizeof(relic_mixfft_plan_t));
+    if (!plan) goto fail;
+
+    plan->n = n;
+    transTableSetup(plan->sofarRadix, plan->actualRadix, plan->remainRadix, &plan->nFactor, &n);
+
+    plan->index = malloc(plan->n * sizeof(int));
+    if (!plan->index) goto fail;
+    setupIndex(plan);
+
+    for (count=1; count<=plan->nFactor; count++)
+    {
+        int sofar = plan->sofarRadix[count];
+        int radix = plan->actualRadix[count];
+
+        initTrig(radix, plan->trigRe[count], plan->trigIm[count]);
+
+        if (sofar > 1)
+        {
+            plan->twiddleRe[count] = malloc(sofar * radix * sizeof(float));
+            plan->twiddleIm[count] = malloc(sofar * radix * sizeof(float));
+            if (!plan->twiddleRe[count] || !plan->twiddleIm[count]) goto fail;
+
+            setupTwiddles(sofar, radix, plan->twiddleRe[count], plan->twiddleIm[count]);
+        }
+    }
+
+    return plan;
+fail:
+    relic_mixfft_plan_free(plan);
+    return NULL;
+}
+
+void relic_mixfft_plan_free(relic_mixfft_plan_t* plan)
+{
+    int count;
+
+    if (!plan) return;
+    for (count=0; count<maxFactorCount; count++)
+    {
+        free(plan->twiddleRe[count]);
+        free(plan->twiddleIm[count]);
+    }
+    free(plan->index);
+    free(plan);
+}
+
+/* same DFTs as twiddleTransf() */
+static void fft_radix(int radix, const float* trigRe, const float* trigIm, float* zRe, float* zIm)
+{
+    float   gem;
+    float   t1_re,t1_im;
+    float   m1_re,m1_im, m2_re,m2_im;
+    float   s1_re,s1_im;
+
+    switch(radix) {
+      case  2  : gem=zRe[0] + zRe[1];
+                 zRe[1]=zRe[0] - zRe[1]; zRe[0]=gem;
+                 gem=zIm[0] + zIm[1];
+                 zIm[1]=zIm[0] - zIm[1]; zIm[0]=gem;
+                 break;
+      case  3  : t1_re=zRe[1] + zRe[2]; t1_im=zIm[1] + zIm[2];
+                 zRe[0]=zRe[0] + t1_re; zIm[0]=zIm[0] + t1_im;
+                 m1_re=c3_1*t1_re; m1_im=c3_1*t1_im;
+                 m2_re=c3_2*(zIm[1] - zIm[2]);
+                 m2_im=c3_2*(zRe[2] - zRe[1]);
+                 s1_re=zRe[0] + m1_re; s1_im=zIm[0] + m1_im;
+                 zRe[1]=s1_re + m2_re; zIm[1]=s1_im + m2_im;
+                 zRe[2]=s1_re - m2_re; zIm[2]=s1_im - m2_im;
+                 break;
+      case  4  : fft_4(zRe, zIm); break;
+      case  5  : fft_5(zRe, zIm); break;
+      case  8  : fft_8(zRe, zIm); break;
+      case 10  : fft_10(zRe, zIm); break;
+      default  : fft_odd(radix, (float*)trigRe, (float*)trigIm, zRe, zIm); break;
+    }
+}
+
+static void planTransf(const relic_mixfft_plan_t* plan, int count, float *yRe, float *yIm)
+{
+    int     sofarRadix = plan->sofarRadix[count];
+    int     radix = plan->actualRadix[count];
+    int     remainRadix = plan->remainRadix[count];
+    const float* twRe = plan->twiddleRe[count];
+    const float* twIm = plan->twiddleIm[count];
+    int     groupOffset,adr;
+    int     groupNo,dataNo,blockNo;
+    float   zRe[maxPrimeFactor], zIm[maxPrimeFactor];
+
+    for (dataNo=0; dataNo<sofarRadix; dataNo++)
+    {
+        for (groupNo=0; groupNo<remainRadix; groupNo++)
+        {
+            groupOffset = groupNo*sofarRadix*radix + dataNo;
+
+            if ((sofarRadix>1) && (dataNo > 0))
+            {
+                zRe[0]=yRe[groupOffset];
+                zIm[0]=yIm[groupOffset];
+                for (blockNo=1; blockNo<radix; blockNo++)
+                {
+                    float twiddleRe = twRe[blockNo*sofarRadix + dataNo];
+                    float twiddleIm = twIm[blockNo*sofarRadix + dataNo];
+                    adr = groupOffset + blockNo*sofarRadix;
+                    zRe[blockNo]=  twiddleRe * yRe[adr]
+                                 - twiddleIm * yIm[adr];
+                    zIm[blockNo]=  twiddleRe * yIm[adr]
+                                 + twiddleIm * yRe[adr];
+                }
+            }
+            else {
+                for (blockNo=0; blockNo<radix; blockNo++)
+                {
+                   adr = groupOffset + blockNo*sofarRadix;
+                   zRe[blockNo]=yRe[adr];
+                   zIm[blockNo]=yIm[adr];
+                }
+            }
+
+            fft_radix(radix, plan->trigRe[count], plan->trigIm[count], zRe, zIm);
+
+            for (blockNo=0; blockNo<radix; blockNo++)
+            {
+                adr = groupOffset + blockNo*sofarRadix;
+                yRe[adr]=zRe[blockNo]; yIm[adr]=zIm[blockNo];
+            }
+        }
+    }
+}
+
+#ifdef RELIC_SIMD
+/* vector versions of the above, with the exact same ops in the same order */
+static inline void fft_4_v(rv4 *aRe, rv4 *aIm)
+{
+    rv4     t1_re,t1_im, t2_re,t2_im;
+    rv4     m2_re,m2_im, m3_re,m3_im;
+
+    t1_re=rv_add(aRe[0], aRe[2]); t1_im=rv_add(aIm[0], aIm[2]);
+    t2_re=rv_add(aRe[1], aRe[3]); t2_im=rv_add(aIm[1], aIm[3]);
+
+    m2_re=rv_sub(aRe[0], aRe[2]); m2_im=rv_sub(aIm[0], aIm[2]);
+    m3_re=rv_sub(aIm[1], aIm[3]); m3_im=rv_sub(aRe[3], aRe[1]);
+
+    aRe[0]=rv_add(t1_re, t2_re); aIm[0]=rv_add(t1_im, t2_im);
+    aRe[2]=rv_sub(t1_re, t2_re); aIm[2]=rv_sub(t1_im, t2_im);
+    aRe[1]=rv_add(m2_re, m3_re); aIm[1]=rv_add(m2_im, m3_im);
+    aRe[3]=rv_sub(m2_re, m3_re); aIm[3]=rv_sub(m2_im, m3_im);
+}
+
+static inline void fft_8_v(rv4 *zRe, rv4 *zIm)
+{
+    rv4     aRe[4], aIm[4], bRe[4], bIm[4], gem;
+    rv4     vc8 = rv_set1(c8);
+    int     i;
+
+    for (i=0; i<4; i++)
+    {
+        aRe[i] = zRe[i*2+0];    bRe[i] = zRe[i*2+1];
+        aIm[i] = zIm[i*2+0];    bIm[i] = zIm[i*2+1];
+    }
+
+    fft_4_v(aRe, aIm); fft_4_v(bRe, bIm);
+
+    gem    = rv_mul(vc8, rv_add(bRe[1], bIm[1]));
+    bIm[1] = rv_mul(vc8, rv_sub(bIm[1], bRe[1]));
+    bRe[1] = gem;
+    gem    = bIm[2];
+    bIm[2] = rv_neg(bRe[2]);
+    bRe[2] = gem;
+    gem    = rv_mul(vc8, rv_sub(bIm[3], bRe[3]));
+    bIm[3] = rv_mul(rv_neg(vc8), rv_add(bRe[3], bIm[3]));
+    bRe[3] = gem;
+
+    for (i=0; i<4; i++)
+    {
+        zRe[i] = rv_add(aRe[i], bRe[i]); zRe[i+4] = rv_sub(aRe[i], bRe[i]);
+        zIm[i] = rv_add(aIm[i], bIm[i]); zIm[i+4] = rv_sub(aIm[i], bIm[i]);
+    }
+}
+
+/* twiddles for dataNo 0 are 1+0i, so multiplying them gives the same values as the scalar copy */
+static void planTransf_v(const relic_mixfft_plan_t* plan, int count, float *yRe, float *yIm)
+{
+    int     sofarRadix = plan->sofarRadix[count];
+    int     radix = plan->actualRadix[count];
+    int     remainRadix = plan->remainRadix[count];
+    const float* twRe = plan->twiddleRe[count];
+    const float* twIm = plan->twiddleIm[count];
+    int     groupOffset,adr;
+    int     groupNo,dataNo,blockNo;
+    rv4     zRe[8], zIm[8];
+
+    for (dataNo=0; dataNo<sofarRadix; dataNo+=4)
+    {
+        for (groupNo=0; groupNo<remainRadix; groupNo++)
+        {
+            groupOffset = groupNo*sofarRadix*radix + dataNo;
+
+            zRe[0]=rv_load(yRe + groupOffset);
+            zIm[0]=rv_load(yIm + groupOffset);
+            for (blockNo=1; blockNo<radix; blockNo++)
+            {
+                rv4 twiddleRe = rv_load(twRe + blockNo*sofarRadix + dataNo);
+                rv4 twiddleIm = rv_load(twIm + blockNo*sofarRadix + dataNo);
+                rv4 re, im;
+                adr = groupOffset + blockNo*sofarRadix;
+                re = rv_load(yRe + adr);
+                im = rv_load(yIm + adr);
+                zRe[blockNo]=rv_sub(rv_mul(twiddleRe, re), rv_mul(twiddleIm, im));
+                zIm[blockNo]=rv_add(rv_mul(twiddleRe, im), rv_mul(twiddleIm, re));
+            }
+
+            switch(radix) {
+              case 2: {
+                rv4 gem;
+                gem=rv_add(zRe[0], zRe[1]);
+                zRe[1]=rv_sub(zRe[0], zRe[1]); zRe[0]=gem;
+                gem=rv_add(zIm[0], zIm[1]);
+                zIm[1]=rv_sub(zIm[0], zIm[1]); zIm[0]=gem;
+                break;
+              }
+              case 4: fft_4_v(zRe, zIm); break;
+              case 8: fft_8_v(zRe, zIm); break;
+              default: break;
+            }
+
+            for (blockNo=0; blockNo<radix; blockNo++)
+            {
+                adr = groupOffset + blockNo*sofarRadix;
+                rv_store(yRe + adr, zRe[blockNo]);
+                rv_store(yIm + adr, zIm[blockNo]);
+            }
+        }
+    }
+}
+#endif
+
+void relic_mixfft_fft_plan(const relic_mixfft_plan_t* plan, const float *xRe, const float *xIm,
+                           float *yRe, float *yIm)
+{
+    int   i, count;
+
+    for (i=0; i<plan->n; i++)
+    {
+        yRe[i] = xRe[plan->index[i]];
+        yIm[i] = xIm[plan->index[i]];
+    }
+
+    for (count=1; count<=plan->nFactor; count++)
+    {
+#ifdef RELIC_SIMD
+        int radix = plan->actualRadix[count];
+        if (plan->sofarRadix[count] % 4 == 0 && (radix == 2 || radix == 4 || radix == 8))
+        {
+            planTransf_v(plan, count, yRe, yIm);
+            continue;
+        }
+#endif
+        planTransf(plan, count, yRe, yIm);
+    }
+}
@@ -1,6 +1,7 @@
 #include "coding.h"
 #include "../util.h"
 #include "../vgmstream.h"
+#include "../util/threads.h"
 
 #ifdef VGM_USE_MPEG
 #include "mpeg_decoder.h"
@@ -12,6 +13,7 @@ static mpg123_handle* init_mpg123_handle(void);
 static void decode_mpeg_standard(VGMSTREAMCHANNEL* stream, mpeg_codec_data* data, sample_t* outbuf, int32_t samples_to_do, int channels);
 static void decode_mpeg_custom(VGMSTREAM* vgmstream, mpeg_codec_data* data, sample_t* outbuf, int32_t samples_to_do, int channels);
 static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data* data, int num_stream);
+static void record_mpeg_index(VGMSTREAM* vgmstream, mpeg_codec_data* data);
 
 
 /* Inits regular MPEG */
@@ -199,8 +201,11 @@ static mpg123_handle* init_mpg123_handle(void) {
     /* inits a new mpg123 handle */
     m = mpg123_new(NULL, &rc);
     if (rc == MPG123_NOT_INITIALIZED) {
-        /* inits the library if needed */
-        if (mpg123_init() != MPG123_OK)
+        /* inits the library if needed (older versions, and not thread-safe) */
+        vgm_global_lock();
+        rc = mpg123_init();
+        vgm_global_unlock();
+        if (rc != MPG123_OK)
             goto fail;
         m = mpg123_new(NULL,&rc);
         if (rc != MPG123_OK) goto fail;
@@ -323,6 +328,7 @@ static void decode_mpeg_custom(VGMSTREAM* vgmstream, mpeg_codec_data* data, samp
                 data->streams[i].samples_used += samples_to_discard;
             }
             data->samples_to_discard -= samples_to_discard;
+            data->samples_position += samples_to_discard;
             samples_to_copy -= samples_to_discard;
         }
 
@@ -351,9 +357,11 @@ static void decode_mpeg_custom(VGMSTREAM* vgmstream, mpeg_codec_data* data, samp
             }
 
             samples_done += samples_to_copy;
+            data->samples_position += samples_to_copy;
         }
         else {
             /* decode more into stream sample buffers */
+            record_mpeg_index(vgmstream, data);
 
             /* Handle offsets depending on the data layout (may only use half VGMSTREAMCHANNELs with 2ch streams)
              * With multiple offsets they should already start in the first frame of each stream. */
@@ -480,6 +488,131 @@ decode_fail:
 }
 
 
+/* Custom MPEG can't be seeked (no global frame table, and custom frames need parsing from the start), so loops
+ * and seeks used to restart and discard everything up to the target. Instead positions/offsets are saved every
+ * few frames while decoding, then seeks restart mpg123 from the nearest saved frame and discard from there.
+ *
+ * Points are only saved when all streams are fully consumed between frames (so mpg123 has no pending data),
+ * and seeks start a few frames before the target, since the first decoded frames are incorrect (no MDCT overlap
+ * and missing bit reservoir bytes from previous frames) and must be discarded. */
+
+#define MPEG_INDEX_INTERVAL_FRAMES  16
+#define MPEG_INDEX_PREROLL_FRAMES   16  /* reservoir is up to 511 bytes, may be several small frames */
+
+/* frame-aligned streams only, as others may have partial frames fed to mpg123 between reads */
+static bool is_index_supported(VGMSTREAM* vgmstream, mpeg_codec_data* data) {
+    if (!data->custom || !data->samples_per_frame)
+        return false;
+    /* blocked layouts keep offsets in the layout state too */
+    if (vgmstream->layout_type != layout_none)
+        return false;
+
+    switch(data->type) {
+        case MPEG_P3D:
+        case MPEG_SCD:
+        case MPEG_LYN:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static void record_mpeg_index(VGMSTREAM* vgmstream, mpeg_codec_data* data) {
+    mpeg_frame_index* index = &data->index;
+
+    if (!is_index_supported(vgmstream, data))
+        return;
+
+    int32_t last_position = index->count ? index->positions[index->count - 1] : 0;
+    if (index->count && data->samples_position < last_position + data->samples_per_frame * MPEG_INDEX_INTERVAL_FRAMES)
+        return;
+
+    for (int i = 0; i < data->streams_size; i++) {
+        mpeg_custom_stream* ms = &data->streams[i];
+        if (ms->buffer_full || ms->samples_filled != ms->samples_used)
+            return;
+    }
+
+    if (index->count >= index->max) {
+        int new_max = index->max ? index->max * 2 : 64;
+
+        int32_t* new_positions = realloc(index->positions, new_max * sizeof(int32_t));
+        if (!new_positions) return;
+        index->positions = new_positions;
+
+        mpeg_index_stream* new_streams = realloc(index->streams, new_max * data->streams_size * sizeof(mpeg_index_stream));
+        if (!new_streams) return;
+        index->streams = new_streams;
+
+        index->max = new_max;
+    }
+
+    index->positions[index->count] = data->samples_position;
+    for (int i = 0; i < data->streams_size; i++) {
+        mpeg_custom_stream* ms = &data->streams[i];
+        mpeg_index_stream* is = &index->streams[index->count * data->streams_size + i];
+
+        is->offset = vgmstream->ch[i].offset;
+        is->current_size_count = ms->current_size_count;
+        is->current_size_target = ms->current_size_target;
+        is->decode_to_discard = ms->decode_to_discard;
+    }
+    index->count++;
+}
+
+/* Moves streams (offsets in chs) to the last saved frame that is far enough before target position, and sets
+ * samples to discard until the target. Only if that frame is after min_position (otherwise no point). */
+static bool restore_mpeg_index(VGMSTREAM* vgmstream, mpeg_codec_data* data, VGMSTREAMCHANNEL* chs, int32_t min_position, int32_t target_position) {
+    mpeg_frame_index* index = &data->index;
+
+    if (!index->count || !is_index_supported(vgmstream, data))
+        return false;
+
+    int32_t max_position = target_position - data->samples_per_frame * MPEG_INDEX_PREROLL_FRAMES;
+
+    /* find last entry <= max */
+    int lo = 0, hi = index->count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (index->positions[mid] <= max_position) {
+            found = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    if (found < 0 || index->positions[found] <= min_position)
+        return false;
+
+    for (int i = 0; i < data->streams_size; i++) {
+        mpeg_custom_stream* ms = &data->streams[i];
+        mpeg_index_stream* is = &index->streams[found * data->streams_size + i];
+
+        mpg123_open_feed(ms->handle);
+        ms->bytes_in_buffer = 0;
+        ms->buffer_full = false;
+        ms->buffer_used = false;
+        ms->samples_filled = 0;
+        ms->samples_used = 0;
+        ms->current_size_count = is->current_size_count;
+        ms->current_size_target = is->current_size_target;
+        ms->decode_to_discard = is->decode_to_discard;
+
+        chs[i].offset = is->offset;
+    }
+
+    data->bytes_in_buffer = 0;
+    data->buffer_full = false;
+    data->buffer_used = false;
+
+    data->samples_position = index->positions[found];
+    data->samples_to_discard = target_position - data->samples_position;
+    return true;
+}
+
+
 /*********/
 /* UTILS */
 /*********/
@@ -504,6 +637,8 @@ void free_mpeg(mpeg_codec_data* data) {
         free(data->streams);
     }
 
+    free(data->index.positions);
+    free(data->index.streams);
     free(data->buffer);
     free(data);
 
@@ -555,6 +690,10 @@ void seek_mpeg(VGMSTREAM* vgmstream, int32_t num_sample) {
             vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset + input_offset;
     }
     else {
+        /* jump to a nearby frame if possible (loop_ch is copied to ch after this) */
+        if (vgmstream->loop_ch && restore_mpeg_index(vgmstream, data, vgmstream->loop_ch, 0, data->skip_samples + num_sample))
+            return;
+
         flush_mpeg(data, 1);
 
         /* restart from 0 and manually discard samples, since we don't really know the correct offset */
@@ -572,6 +711,19 @@ void seek_mpeg(VGMSTREAM* vgmstream, int32_t num_sample) {
     }
 }
 
+/* skips samples from current position by jumping to a nearby indexed frame, returns skipped samples */
+int32_t skip_mpeg(VGMSTREAM* vgmstream, int32_t samples) {
+    mpeg_codec_data* data = vgmstream->codec_data;
+    if (!data || !data->custom)
+        return 0;
+
+    int32_t current_position = data->samples_position + data->samples_to_discard;
+    if (!restore_mpeg_index(vgmstream, data, vgmstream->ch, current_position, current_position + samples))
+        return 0;
+
+    return samples;
+}
+
 /* resets mpg123 decoder and its internals without seeking, useful when a new MPEG substream starts */
 static void flush_mpeg(mpeg_codec_data* data, int is_loop) {
     if (!data)
@@ -588,8 +740,9 @@ static void flush_mpeg(mpeg_codec_data* data, int is_loop) {
                 continue;
 
             /* On loop FSB retains MDCT state so it mixes with next/loop frame (confirmed with recordings).
-             * This only matters on full loops and if there is no encoder delay (since loops use discard right now) */
-            if (is_loop && data->custom && !(data->type == MPEG_FSB))
+             * This only matters on full loops and if there is no encoder delay (since loops use discard right now).
+             * Resets must always clear it though, as mpg123 may also have pending data from the old position. */
+            if (!is_loop || !(data->type == MPEG_FSB))
                 mpg123_open_feed(data->streams[i].handle);
             data->streams[i].bytes_in_buffer = 0;
             data->streams[i].buffer_full = false;
@@ -602,6 +755,7 @@ static void flush_mpeg(mpeg_codec_data* data, int is_loop) {
         }
 
         data->samples_to_discard = data->skip_samples;
+        data->samples_position = 0;
     }
 
     data->bytes_in_buffer = 0;
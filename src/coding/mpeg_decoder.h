@@ -32,6 +32,22 @@ typedef struct {
     int channels_per_frame; /* for rare cases that streams don't share this */
 } mpeg_custom_stream;
 
+/* custom stream state at a frame boundary, to restart decoding from there */
+typedef struct {
+    off_t offset;
+    size_t current_size_count;
+    size_t current_size_target;
+    size_t decode_to_discard;
+} mpeg_index_stream;
+
+/* frame index of custom MPEG, built while decoding to speed up seeks */
+typedef struct {
+    int32_t* positions; /* samples since start (including skip_samples) per entry */
+    mpeg_index_stream* streams; /* state of each stream per entry (entries * streams_size) */
+    int count;
+    int max;
+} mpeg_frame_index;
+
 struct mpeg_codec_data {
     /* regular/single MPEG internals */
     uint8_t* buffer; /* raw data buffer */
@@ -62,6 +78,8 @@ struct mpeg_codec_data {
     size_t skip_samples; /* base encoder delay */
     size_t samples_to_discard; /* for custom mpeg looping */
 
+    int32_t samples_position; /* samples done since start (including discards), for the index */
+    mpeg_frame_index index;
 };
 
 int mpeg_custom_setup_init_default(STREAMFILE* sf, off_t start_offset, mpeg_codec_data* data, coding_t* coding_type);
@@ -1,6 +1,7 @@
 #include <math.h>
 #include "coding.h"
 #include "../util.h"
+#include "../util/samples_ops.h"
 
 #ifdef VGM_USE_VORBIS
 #define OV_EXCLUDE_STATIC_CALLBACKS
@@ -253,27 +254,19 @@ static const int xiph_channel_map[8][8] = {
 
 /* converts from internal Vorbis format to standard PCM and remaps (mostly from Xiph's decoder_example.c) */
 static void pcm_convert_float_to_16(int channels, sample_t* outbuf, int start_sample, int samples_to_do, float** pcm, int disable_ordering) {
-    int ch, s, ch_map;
-    sample_t *ptr;
-    float *channel;
+    float* pcm_map[8];
 
-    /* convert float PCM (multichannel float array, with pcm[0]=ch0, pcm[1]=ch1, pcm[2]=ch0, etc)
-     * to 16 bit signed PCM ints (host order) and interleave + fix clipping */
-    for (ch = 0; ch < channels; ch++) {
-        ch_map = disable_ordering ?
-                ch :
-                (channels > 8) ? ch : xiph_channel_map[channels - 1][ch]; /* put Vorbis' ch to other outbuf's ch */
-        ptr = outbuf + ch;
-        channel = pcm[ch_map];
-        for (s = start_sample; s < samples_to_do; s++) {
-            int val = (int)floor(channel[s] * 32767.0f + 0.5f); /* use floorf? doesn't seem any faster */
-            if (val > 32767) val = 32767;
-            else if (val < -32768) val = -32768;
-
-            *ptr = val;
-            ptr += channels;
+    /* put Vorbis' ch to other outbuf's ch */
+    if (!disable_ordering && channels <= 8) {
+        for (int ch = 0; ch < channels; ch++) {
+            pcm_map[ch] = pcm[xiph_channel_map[channels - 1][ch]];
         }
+        pcm = pcm_map;
     }
+
+    /* convert float PCM (multichannel float array, with pcm[0]=ch0, pcm[1]=ch1, pcm[2]=ch0, etc)
+     * to 16 bit signed PCM ints (host order) and interleave + fix clipping */
+    samples_f32p_to_s16_floor(outbuf, pcm, channels, start_sample, samples_to_do - start_sample, 32767.0f);
 }
 
 /* ********************************************** */
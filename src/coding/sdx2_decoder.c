@@ -10,7 +10,7 @@
  
 
 /* for (i=-128;i<128;i++) { squares[i+128] = i<0?(-i*i)*2:(i*i)*2; } */
-static int16_t squares[256] = {
+static const int16_t squares[256] = {
         -32768,-32258,-31752,-31250,-30752,-30258,-29768,-29282,-28800,-28322,-27848,
         -27378,-26912,-26450,-25992,-25538,-25088,-24642,-24200,-23762,-23328,-22898,
         -22472,-22050,-21632,-21218,-20808,-20402,-20000,-19602,-19208,-18818,-18432,
@@ -51,7 +51,7 @@ for (uint16_t i = 0; i < 0x100; i += 1) {
     cubes[i] = a;
 }
 */
-static int16_t cubes[256] = {
+static const int16_t cubes[256] = {
         -32768,-32006,-31256,-30518,-29791,-29077,-28373,-27681,-27000,-26331,-25673,
         -25026,-24389,-23764,-23150,-22546,-21952,-21370,-20797,-20235,-19683,-19142,
         -18610,-18088,-17576,-17074,-16582,-16099,-15625,-15161,-14707,-14261,-13824,
@@ -78,7 +78,7 @@ static int16_t cubes[256] = {
          30517, 31255, 32005
 };
 
-static void decode_delta_exact(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int16_t * table) {
+static void decode_delta_exact(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, const int16_t * table) {
     int32_t hist = stream->adpcm_history1_32;
 
     int i;
@@ -98,7 +98,7 @@ static void decode_delta_exact(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int
     stream->adpcm_history1_32 = hist;
 }
 
-static void decode_delta_exact_int(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int16_t * table) {
+static void decode_delta_exact_int(VGMSTREAMCHANNEL * stream, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, const int16_t * table) {
     int32_t hist = stream->adpcm_history1_32;
 
     int i;
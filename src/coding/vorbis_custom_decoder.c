@@ -1,12 +1,12 @@
 #include <math.h>
 #include "coding.h"
 #include "vorbis_custom_decoder.h"
+#include "../util/samples_ops.h"
 
 #ifdef VGM_USE_VORBIS
 
 #define VORBIS_DEFAULT_BUFFER_SIZE 0x8000 /* should be at least the size of the setup header, ~0x2000 */
 
-static void pcm_convert_float_to_16(sample_t* outbuf, int samples_to_do, float** pcm, int channels);
 
 /**
  * Inits a vorbis stream of some custom variety.
@@ -107,7 +107,7 @@ void decode_vorbis_custom(VGMSTREAM* vgmstream, sample_t* outbuf, int32_t sample
                 /* get max samples and convert from Vorbis float pcm to 16bit pcm */
                 if (samples_to_get > samples_to_do - samples_done)
                     samples_to_get = samples_to_do - samples_done;
-                pcm_convert_float_to_16(outbuf + samples_done * channels, samples_to_get, pcm, data->vi.channels);
+                samples_f32p_to_s16_floor(outbuf + samples_done * channels, pcm, data->vi.channels, 0, samples_to_get, 32767.0f);
                 samples_done += samples_to_get;
             }
 
@@ -168,29 +168,6 @@ decode_fail:
     memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(sample_t));
 }
 
-/* converts from internal Vorbis format to standard PCM (mostly from Xiph's decoder_example.c) */
-static void pcm_convert_float_to_16(sample_t* outbuf, int samples_to_do, float** pcm, int channels) {
-    int ch, s;
-    sample_t* ptr;
-    float* channel;
-
-    /* convert float PCM (multichannel float array, with pcm[0]=ch0, pcm[1]=ch1, pcm[2]=ch0, etc)
-     * to 16 bit signed PCM ints (host order) and interleave + fix clipping */
-    for (ch = 0; ch < channels; ch++) {
-        /* channels should be in standard order unlike Ogg Vorbis (at least in FSB) */
-        ptr = outbuf + ch;
-        channel = pcm[ch];
-        for (s = 0; s < samples_to_do; s++) {
-            int val = (int)floor(channel[s] * 32767.0f + 0.5f);
-            if (val > 32767) val = 32767;
-            else if (val < -32768) val = -32768;
-
-            *ptr = val;
-            ptr += channels;
-        }
-    }
-}
-
 /* ********************************************** */
 
 void free_vorbis_custom(vorbis_custom_codec_data* data) {
@@ -207,6 +184,10 @@ void free_vorbis_custom(vorbis_custom_codec_data* data) {
     free(data);
 }
 
+void free_vorbis_custom_cache(void) {
+    vorbis_custom_free_cache_wwise();
+}
+
 void reset_vorbis_custom(VGMSTREAM* vgmstream) {
     vorbis_custom_codec_data *data = vgmstream->codec_data;
     if (!data) return;
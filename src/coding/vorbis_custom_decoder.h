@@ -52,13 +52,15 @@ int vorbis_custom_parse_packet_ogl(VGMSTREAMCHANNEL* stream, vorbis_custom_codec
 int vorbis_custom_parse_packet_sk(VGMSTREAMCHANNEL* stream, vorbis_custom_codec_data* data);
 int vorbis_custom_parse_packet_vid1(VGMSTREAMCHANNEL* stream, vorbis_custom_codec_data* data);
 int vorbis_custom_parse_packet_awc(VGMSTREAMCHANNEL* stream, vorbis_custom_codec_data* data);
-#endif/* VGM_USE_VORBIS */
+
+void vorbis_custom_free_cache_wwise(void);
 
 /* other utils to make/parse vorbis stuff */
 int build_header_comment(uint8_t* buf, int bufsize);
 int build_header_identification(uint8_t* buf, int bufsize, vorbis_custom_config* cfg);
 void load_blocksizes(vorbis_custom_config* cfg, int blocksize_short, int blocksize_long);
 bool load_header_packet(STREAMFILE* sf, vorbis_custom_codec_data* data, uint32_t packet_size, int packet_skip, uint32_t* p_offset);
+#endif/* VGM_USE_VORBIS */
 
 
 #endif/*_VORBIS_CUSTOM_DECODER_H_ */
@@ -3,6 +3,7 @@
 #ifdef VGM_USE_VORBIS
 #include <vorbis/codec.h>
 #include "../util/bitstream_lsb.h"
+#include "../util/threads.h"
 
 #define WWISE_VORBIS_USE_PRECOMPILED_WVC 1 /* if enabled vgmstream weights ~150kb more but doesn't need external .wvc packets */
 #if WWISE_VORBIS_USE_PRECOMPILED_WVC
@@ -36,6 +37,9 @@ static int load_wvc_file(uint8_t* buf, size_t bufsize, uint32_t codebook_id, STR
 #endif
 static int load_wvc_array(uint8_t* buf, size_t bufsize, uint32_t codebook_id, wwise_setup_t setup_type);
 
+static bool setup_cache_get(uint8_t* obuf, size_t obufsize, size_t* p_setup_size, const uint8_t* ibuf, size_t ibufsize, vorbis_custom_codec_data* data);
+static void setup_cache_add(const uint8_t* setup, size_t setup_size, const uint8_t* ibuf, size_t ibufsize, vorbis_custom_codec_data* data);
+
 
 /* **************************************************************************** */
 /* EXTERNAL API                                                                 */
@@ -238,6 +242,12 @@ static size_t rebuild_setup(uint8_t* obuf, size_t obufsize, wpacket_t* wp, STREA
     ok = read_packet(wp, ibuf, ibufsize, sf, offset, data, 1);
     if (!ok) goto fail;
 
+    {
+        size_t setup_size;
+        if (setup_cache_get(obuf, obufsize, &setup_size, ibuf, wp->packet_size, data))
+            return setup_size;
+    }
+
     bl_setup(&ow, obuf, obufsize);
     bl_setup(&iw, ibuf, ibufsize);
 
@@ -249,6 +259,7 @@ static size_t rebuild_setup(uint8_t* obuf, size_t obufsize, wpacket_t* wp, STREA
         goto fail;
     }
 
+    setup_cache_add(obuf, ow.b_off / 8, ibuf, wp->packet_size, data);
 
     return ow.b_off / 8;
 fail:
@@ -1210,4 +1221,131 @@ fail:
     return 0;
 }
 
+/* **************************************************************************** */
+/* SETUP CACHE                                                                  */
+/* **************************************************************************** */
+
+/* Rebuilding setups (mainly expanding codebooks) is slow-ish, and banks with thousands of .wem
+ * share a few setups, so rebuilt ones are kept around for the whole process. Only done with
+ * precompiled codebooks, as the result would depend on the file's folder with external .wvc. */
+#define WWISE_SETUP_CACHE_MAX  32
+
+#if WWISE_VORBIS_USE_PRECOMPILED_WVC
+typedef struct {
+    uint32_t hash;
+    int channels;
+    wwise_setup_t setup_type;
+    uint8_t* wsetup;        /* original Wwise setup */
+    size_t wsetup_size;
+
+    uint8_t* setup;         /* rebuilt Vorbis setup */
+    size_t setup_size;
+    uint8_t mode_blockflag[64+1];
+    int mode_bits;
+} wwise_setup_entry_t;
+
+static wwise_setup_entry_t g_setup_cache[WWISE_SETUP_CACHE_MAX];
+static int g_setup_cache_next; /* next entry to replace */
+
+/* FNV-1a */
+static uint32_t setup_cache_hash(const uint8_t* buf, size_t size) {
+    uint32_t hash = 0x811C9DC5;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ buf[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static wwise_setup_entry_t* setup_cache_find(uint32_t hash, const uint8_t* ibuf, size_t ibufsize, vorbis_custom_codec_data* data) {
+    for (int i = 0; i < WWISE_SETUP_CACHE_MAX; i++) {
+        wwise_setup_entry_t* entry = &g_setup_cache[i];
+        if (entry->setup && entry->hash == hash && entry->wsetup_size == ibufsize
+                && entry->channels == data->config.channels && entry->setup_type == data->config.setup_type
+                && memcmp(entry->wsetup, ibuf, ibufsize) == 0)
+            return entry;
+    }
+    return NULL;
+}
+#endif
+
+static bool setup_cache_get(uint8_t* obuf, size_t obufsize, size_t* p_setup_size, const uint8_t* ibuf, size_t ibufsize, vorbis_custom_codec_data* data) {
+#if WWISE_VORBIS_USE_PRECOMPILED_WVC
+    uint32_t hash = setup_cache_hash(ibuf, ibufsize);
+    wwise_setup_entry_t* entry;
+    bool found = false;
+
+    vgm_global_lock();
+    entry = setup_cache_find(hash, ibuf, ibufsize, data);
+    if (entry && entry->setup_size <= obufsize) {
+        memcpy(obuf, entry->setup, entry->setup_size);
+        memcpy(data->mode_blockflag, entry->mode_blockflag, sizeof(data->mode_blockflag));
+        data->mode_bits = entry->mode_bits;
+        *p_setup_size = entry->setup_size;
+        found = true;
+    }
+    vgm_global_unlock();
+
+    return found;
+#else
+    return false;
+#endif
+}
+
+static void setup_cache_add(const uint8_t* setup, size_t setup_size, const uint8_t* ibuf, size_t ibufsize, vorbis_custom_codec_data* data) {
+#if WWISE_VORBIS_USE_PRECOMPILED_WVC
+    uint32_t hash = setup_cache_hash(ibuf, ibufsize);
+    uint8_t* wsetup_copy = NULL;
+    uint8_t* setup_copy = NULL;
+
+    /* alloc outside the lock */
+    wsetup_copy = malloc(ibufsize);
+    setup_copy = malloc(setup_size);
+    if (!wsetup_copy || !setup_copy) goto fail;
+    memcpy(wsetup_copy, ibuf, ibufsize);
+    memcpy(setup_copy, setup, setup_size);
+
+    vgm_global_lock();
+    if (!setup_cache_find(hash, ibuf, ibufsize, data)) { /* other thread may have added it */
+        wwise_setup_entry_t* entry = &g_setup_cache[g_setup_cache_next];
+        g_setup_cache_next = (g_setup_cache_next + 1) % WWISE_SETUP_CACHE_MAX;
+
+        /* swap old bufs to free them later */
+        uint8_t* old_wsetup = entry->wsetup;
+        uint8_t* old_setup = entry->setup;
+
+        entry->hash = hash;
+        entry->channels = data->config.channels;
+        entry->setup_type = data->config.setup_type;
+        entry->wsetup = wsetup_copy;
+        entry->wsetup_size = ibufsize;
+        entry->setup = setup_copy;
+        entry->setup_size = setup_size;
+        memcpy(entry->mode_blockflag, data->mode_blockflag, sizeof(entry->mode_blockflag));
+        entry->mode_bits = data->mode_bits;
+
+        wsetup_copy = old_wsetup;
+        setup_copy = old_setup;
+    }
+    vgm_global_unlock();
+
+fail:
+    free(wsetup_copy);
+    free(setup_copy);
+#endif
+}
+
+void vorbis_custom_free_cache_wwise(void) {
+#if WWISE_VORBIS_USE_PRECOMPILED_WVC
+    vgm_global_lock();
+    for (int i = 0; i < WWISE_SETUP_CACHE_MAX; i++) {
+        wwise_setup_entry_t* entry = &g_setup_cache[i];
+        free(entry->wsetup);
+        free(entry->setup);
+    }
+    memset(g_setup_cache, 0, sizeof(g_setup_cache));
+    g_setup_cache_next = 0;
+    vgm_global_unlock();
+#endif
+}
+
 #endif
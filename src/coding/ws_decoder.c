@@ -5,8 +5,8 @@
 /* Westwood Studios ADPCM */
 /* Based on Valery V. Anisimovsky's WS-AUD.txt */
 
-static char WSTable2bit[4] = { -2, -1, 0, 1 };
-static char WSTable4bit[16] = { -9, -8, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 8 };
+static const char WSTable2bit[4] = { -2, -1, 0, 1 };
+static const char WSTable4bit[16] = { -9, -8, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 8 };
 
 /* We pass in the VGMSTREAM here, unlike in other codings, because the decoder has to know about the block structure. */
 void decode_ws(VGMSTREAM* vgmstream, int channel, sample_t * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
@@ -2,6 +2,8 @@
 #include "../vgmstream.h"
 #include "../base/decode.h"
 #include "../base/sbuf.h"
+#include "../base/decode_parallel.h"
+#include "../base/seek_index.h"
 #include "../coding/coding.h"
 
 
@@ -70,6 +72,9 @@ void render_vgmstream_blocked(sample_t* outbuf, int32_t sample_count, VGMSTREAM*
         /* move to next block when all samples are consumed */
         if (vgmstream->samples_into_block == samples_this_block
                 /*&& vgmstream->current_sample < vgmstream->num_samples*/) { /* don't go past last block */ //todo
+            if (vgmstream->seek_index) {
+                seek_index_record_block(vgmstream);
+            }
             block_update(vgmstream->next_block_offset, vgmstream);
 
             /* update since these may change each block */
@@ -97,6 +102,11 @@ decode_fail:
 
 /* helper functions to parse new block */
 void block_update(off_t block_offset, VGMSTREAM* vgmstream) {
+    /* blocks change channel state so pending frames must be decoded first */
+    if (vgmstream->parallel_data) {
+        decode_parallel_flush(vgmstream);
+    }
+
     switch (vgmstream->layout_type) {
         case layout_blocked_ast:
             block_update_ast(block_offset,vgmstream);
@@ -10,6 +10,32 @@
 #define VGMSTREAM_LAYER_SAMPLE_BUFFER 8192
 
 
+/* renders a single layer into its own buffer (may be called from other threads) */
+static void render_layer_parallel(void* ctx, int index) {
+    layered_layout_data* data = ctx;
+    VGMSTREAM* layer = data->layers[index];
+    sbuf_t* ssrc = &data->layer_sbufs[index];
+
+    sfmt_t format = mixing_get_input_sample_type(layer);
+    sbuf_init(ssrc, format, data->layer_buffers[index], data->samples_to_do, layer->channels);
+
+    render_main(ssrc, layer);
+}
+
+/* Layers are independent VGMSTREAMs, so they can be decoded at the same time then merged in order.
+ * Looping (decode_do_loop + loop_layout) and seeking are done outside, as usual. */
+static void render_layers_parallel(sbuf_t* sdst, layered_layout_data* data, int samples_to_do) {
+    data->samples_to_do = samples_to_do;
+    vgm_pool_run(data->pool, data->layer_count, render_layer_parallel, data);
+
+    int ch = 0;
+    for (int current_layer = 0; current_layer < data->layer_count; current_layer++) {
+        sbuf_t* ssrc = &data->layer_sbufs[current_layer];
+        sbuf_copy_layers(sdst, ssrc, ch, samples_to_do);
+        ch += ssrc->channels;
+    }
+}
+
 /* Decodes samples for layered streams.
  * Each decoded vgmstream 'layer' (which may have different codecs and number of channels)
  * is mixed into a final buffer, creating a single super-vgmstream. */
@@ -39,18 +65,23 @@ void render_vgmstream_layered(sbuf_t* sdst, VGMSTREAM* vgmstream) {
             goto decode_fail;
         }
 
-        /* decode all layers */
-        ch = 0;
-        for (int current_layer = 0; current_layer < data->layer_count; current_layer++) {
-            /* layers may have their own number of channels/format (buf is as big as needed) */
-            sfmt_t format = mixing_get_input_sample_type(data->layers[current_layer]);
-            sbuf_init(ssrc, format, data->buffer, samples_to_do, data->layers[current_layer]->channels);
-
-            render_main(ssrc, data->layers[current_layer]);
-
-            /* mix layer samples to main samples */
-            sbuf_copy_layers(sdst, ssrc, ch, samples_to_do);
-            ch += ssrc->channels;
+        if (data->pool) {
+            render_layers_parallel(sdst, data, samples_to_do);
+        }
+        else {
+            /* decode all layers */
+            ch = 0;
+            for (int current_layer = 0; current_layer < data->layer_count; current_layer++) {
+                /* layers may have their own number of channels/format (buf is as big as needed) */
+                sfmt_t format = mixing_get_input_sample_type(data->layers[current_layer]);
+                sbuf_init(ssrc, format, data->buffer, samples_to_do, data->layers[current_layer]->channels);
+
+                render_main(ssrc, data->layers[current_layer]);
+
+                /* mix layer samples to main samples */
+                sbuf_copy_layers(sdst, ssrc, ch, samples_to_do);
+                ch += ssrc->channels;
+            }
         }
 
         sdst->filled += samples_to_do;
@@ -198,6 +229,47 @@ fail:
     return false; /* caller is expected to free */
 }
 
+static void free_layout_layered_parallel(layered_layout_data* data) {
+    if (data->layer_buffers) {
+        for (int i = 0; i < data->layer_count; i++) {
+            free(data->layer_buffers[i]);
+        }
+    }
+    free(data->layer_buffers);
+    free(data->layer_sbufs);
+
+    data->layer_buffers = NULL;
+    data->layer_sbufs = NULL;
+    data->pool = NULL;
+}
+
+bool setup_layout_layered_parallel(layered_layout_data* data, vgm_pool_t* pool) {
+    free_layout_layered_parallel(data);
+    if (!pool)
+        return true;
+
+    data->layer_buffers = calloc(data->layer_count, sizeof(void*));
+    if (!data->layer_buffers) goto fail;
+
+    data->layer_sbufs = calloc(data->layer_count, sizeof(sbuf_t));
+    if (!data->layer_sbufs) goto fail;
+
+    for (int i = 0; i < data->layer_count; i++) {
+        int layer_input_channels;
+        mixing_info(data->layers[i], &layer_input_channels, NULL);
+        int sample_size = sfmt_get_sample_size( mixing_get_input_sample_type(data->layers[i]) );
+
+        data->layer_buffers[i] = malloc(VGMSTREAM_LAYER_SAMPLE_BUFFER * layer_input_channels * sample_size);
+        if (!data->layer_buffers[i]) goto fail;
+    }
+
+    data->pool = pool;
+    return true;
+fail:
+    free_layout_layered_parallel(data);
+    return false;
+}
+
 void free_layout_layered(layered_layout_data* data) {
     if (!data)
         return;
@@ -205,6 +277,7 @@ void free_layout_layered(layered_layout_data* data) {
     for (int i = 0; i < data->layer_count; i++) {
         close_vgmstream(data->layers[i]);
     }
+    free_layout_layered_parallel(data);
     free(data->layers);
     free(data->buffer);
     free(data);
@@ -6,6 +6,7 @@
 #include "../util/reader_sf.h"
 #include "../util/log.h"
 #include "../base/sbuf.h"
+#include "../util/threads.h"
 
 /* basic layouts */
 void render_vgmstream_flat(sample_t* buffer, int32_t sample_count, VGMSTREAM* vgmstream);
@@ -23,6 +24,7 @@ typedef struct {
     int input_channels;     /* internal buffer channels */
     int output_channels;    /* resulting channels (after mixing, if applied) */
     bool mixed_channels;     /* segments have different number of channels */
+    struct segmented_prefetch_t* prefetch; /* optional background render of next segment */
 } segmented_layout_data;
 
 void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream);
@@ -32,6 +34,8 @@ void free_layout_segmented(segmented_layout_data* data);
 void reset_layout_segmented(segmented_layout_data* data);
 void seek_layout_segmented(VGMSTREAM* vgmstream, int32_t seek_sample);
 void loop_layout_segmented(VGMSTREAM* vgmstream, int32_t loop_sample);
+/* renders the start of the next segment in a background thread (or disables it); call after setup */
+bool setup_layout_segmented_prefetch(segmented_layout_data* data, bool enable);
 
 
 /* layered layout */
@@ -44,6 +48,12 @@ typedef struct {
     int output_channels;    /* resulting channels (after mixing, if applied) */
     int external_looping;   /* don't loop using per-layer loops, but layout's own looping */
     int curr_layer;         /* helper */
+
+    /* parallel rendering (optional) */
+    vgm_pool_t* pool;       /* shared threads (not owned) */
+    void** layer_buffers;   /* one buffer per layer, so they can be rendered at the same time */
+    sbuf_t* layer_sbufs;
+    int samples_to_do;      /* current render */
 } layered_layout_data;
 
 void render_vgmstream_layered(sbuf_t* sbuf, VGMSTREAM* vgmstream);
@@ -53,6 +63,8 @@ void free_layout_layered(layered_layout_data* data);
 void reset_layout_layered(layered_layout_data* data);
 void seek_layout_layered(VGMSTREAM* vgmstream, int32_t seek_sample);
 void loop_layout_layered(VGMSTREAM* vgmstream, int32_t loop_sample);
+/* renders layers in parallel using pool's threads (or disables it if NULL); call after setup */
+bool setup_layout_layered_parallel(layered_layout_data* data, vgm_pool_t* pool);
 
 
 /* blocked layouts */
@@ -10,6 +10,171 @@
 #define VGMSTREAM_SEGMENT_SAMPLE_BUFFER 8192
 
 
+/* Segment changes reset the next segment and decode its first frames, which may be slow-ish for some codecs
+ * (reopening/setup, big first frames, etc) and cause hiccups in realtime playback. When enabled a thread
+ * resets and renders the start of the next segment while current one plays, so changes just copy samples.
+ * Only the main thread touches 'segment/pos' and the worker only touches the next segment while busy. */
+typedef struct segmented_prefetch_t {
+    vgm_thread_t* thread;
+    vgm_mutex_t* mutex;
+    vgm_cond_t* cond;
+
+    void* buffer;
+    int segment;                /* prefetched (or being prefetched) segment, -1 if none */
+    int samples;                /* rendered samples in buffer */
+    int pos;                    /* consumed samples once segment is current */
+    bool active;                /* segment is current and buffer is being consumed */
+
+    /* protected by mutex */
+    bool busy;
+    bool stop;
+    VGMSTREAM* request;
+} segmented_prefetch_t;
+
+static void prefetch_worker(void* arg) {
+    segmented_layout_data* data = arg;
+    segmented_prefetch_t* pf = data->prefetch;
+
+    vgm_mutex_lock(pf->mutex);
+    while (true) {
+        while (!pf->stop && !pf->request) {
+            vgm_cond_wait(pf->cond, pf->mutex);
+        }
+        if (pf->stop)
+            break;
+
+        VGMSTREAM* segment = pf->request;
+        vgm_mutex_unlock(pf->mutex);
+
+        int samples_to_do = vgmstream_get_samples(segment);
+        if (samples_to_do > VGMSTREAM_SEGMENT_SAMPLE_BUFFER)
+            samples_to_do = VGMSTREAM_SEGMENT_SAMPLE_BUFFER;
+
+        sbuf_t ssrc;
+        sfmt_t segment_format = mixing_get_input_sample_type(segment);
+        sbuf_init(&ssrc, segment_format, pf->buffer, samples_to_do, segment->channels);
+
+        reset_vgmstream(segment);
+        int samples = render_main(&ssrc, segment);
+
+        vgm_mutex_lock(pf->mutex);
+        pf->samples = samples;
+        pf->request = NULL;
+        pf->busy = false;
+        vgm_cond_broadcast(pf->cond);
+    }
+    vgm_mutex_unlock(pf->mutex);
+}
+
+static void prefetch_wait(segmented_prefetch_t* pf) {
+    vgm_mutex_lock(pf->mutex);
+    while (pf->busy) {
+        vgm_cond_wait(pf->cond, pf->mutex);
+    }
+    vgm_mutex_unlock(pf->mutex);
+}
+
+/* discards current prefetch, must be called before touching segments outside the render loop */
+static void prefetch_cancel(segmented_layout_data* data) {
+    segmented_prefetch_t* pf = data->prefetch;
+    if (!pf)
+        return;
+
+    prefetch_wait(pf);
+    pf->segment = -1;
+    pf->samples = 0;
+    pf->pos = 0;
+    pf->active = false;
+}
+
+/* STREAMFILEs aren't thread-safe (subsongs of the same file usually open their own though). Only ch[] ones
+ * can be compared, as some codecs keep the caller's STREAMFILE in codec_data (ex. MP4 AAC, Ogg Vorbis) and
+ * sub-layouts have their own, so those segments are never prefetched. */
+static bool has_shared_streamfiles(VGMSTREAM* vgmstream1, VGMSTREAM* vgmstream2) {
+    if (vgmstream1->codec_data || vgmstream1->layout_data || vgmstream2->codec_data || vgmstream2->layout_data)
+        return true;
+
+    for (int i = 0; i < vgmstream1->channels; i++) {
+        for (int j = 0; j < vgmstream2->channels; j++) {
+            if (vgmstream1->ch[i].streamfile && vgmstream1->ch[i].streamfile == vgmstream2->ch[j].streamfile)
+                return true;
+        }
+    }
+    return false;
+}
+
+/* starts rendering next segment if possible */
+static void prefetch_next(segmented_layout_data* data) {
+    segmented_prefetch_t* pf = data->prefetch;
+    if (!pf || pf->segment >= 0)
+        return;
+
+    int next = data->current_segment + 1;
+    if (next >= data->segment_count)
+        return;
+    /* repeated segments are handled by the usual reset */
+    if (data->segments[next] == data->segments[data->current_segment])
+        return;
+    if (has_shared_streamfiles(data->segments[next], data->segments[data->current_segment]))
+        return;
+
+    vgm_mutex_lock(pf->mutex);
+    pf->segment = next;
+    pf->samples = 0;
+    pf->pos = 0;
+    pf->active = false;
+    pf->busy = true;
+    pf->request = data->segments[next];
+    vgm_cond_signal(pf->cond);
+    vgm_mutex_unlock(pf->mutex);
+}
+
+/* on segment change, returns true if the (now current) segment was prefetched and doesn't need a reset */
+static bool prefetch_take(segmented_layout_data* data) {
+    segmented_prefetch_t* pf = data->prefetch;
+    if (!pf || pf->segment < 0)
+        return false;
+
+    prefetch_wait(pf);
+    if (pf->segment != data->current_segment || pf->samples <= 0) {
+        prefetch_cancel(data);
+        return false;
+    }
+
+    pf->active = true;
+    return true;
+}
+
+/* copies prefetched samples of current segment, returns 0 if there aren't any left */
+static int prefetch_read(segmented_layout_data* data, sbuf_t* sbuf, int samples_to_do) {
+    segmented_prefetch_t* pf = data->prefetch;
+    if (!pf || !pf->active)
+        return 0;
+
+    if (samples_to_do > pf->samples - pf->pos)
+        samples_to_do = pf->samples - pf->pos;
+
+    VGMSTREAM* segment = data->segments[data->current_segment];
+    sfmt_t segment_format = mixing_get_input_sample_type(segment);
+    int sample_size = sfmt_get_sample_size(segment_format);
+    uint8_t* buf = pf->buffer;
+
+    sbuf_t ssrc;
+    sbuf_init(&ssrc, segment_format, buf + pf->pos * segment->channels * sample_size, samples_to_do, segment->channels);
+    ssrc.filled = samples_to_do;
+    sbuf_copy_segments(sbuf, &ssrc);
+
+    pf->pos += samples_to_do;
+    if (pf->pos >= pf->samples) {
+        /* done, free to prefetch the next one */
+        pf->segment = -1;
+        pf->active = false;
+    }
+
+    return samples_to_do;
+}
+
+
 /* Decodes samples for segmented streams.
  * Chains together sequential vgmstreams, for data divided into separate sections or files
  * (like one part for intro and other for loop segments, which may even use different codecs). */
@@ -51,7 +216,9 @@ void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream) {
             }
 
             /* in case of looping spanning multiple segments */
-            reset_vgmstream(data->segments[data->current_segment]);
+            if (!prefetch_take(data)) {
+                reset_vgmstream(data->segments[data->current_segment]);
+            }
 
             samples_this_block = vgmstream_get_samples(data->segments[data->current_segment]);
             mixing_info(data->segments[data->current_segment], NULL, &current_channels);
@@ -71,6 +238,16 @@ void render_vgmstream_segmented(sbuf_t* sbuf, VGMSTREAM* vgmstream) {
             goto decode_fail;
         }
 
+        prefetch_next(data);
+
+        int samples_prefetched = prefetch_read(data, sbuf, samples_to_do);
+        if (samples_prefetched > 0) {
+            sbuf->filled += samples_prefetched;
+            vgmstream->current_sample += samples_prefetched;
+            vgmstream->samples_into_block += samples_prefetched;
+            continue;
+        }
+
         segment_format = mixing_get_input_sample_type(data->segments[data->current_segment]);
         sbuf_init(ssrc, segment_format, data->buffer, samples_to_do, data->segments[data->current_segment]->channels);
 
@@ -101,6 +278,8 @@ decode_fail:
 void seek_layout_segmented(VGMSTREAM* vgmstream, int32_t seek_sample) {
     segmented_layout_data* data = vgmstream->layout_data;
 
+    prefetch_cancel(data);
+
     int segment = 0;
     int total_samples = 0;
     while (total_samples < vgmstream->num_samples) {
@@ -242,6 +421,8 @@ void free_layout_segmented(segmented_layout_data* data) {
     if (!data)
         return;
 
+    setup_layout_segmented_prefetch(data, false);
+
     for (int i = 0; i < data->segment_count; i++) {
         bool is_repeat = false;
 
@@ -266,9 +447,61 @@ void reset_layout_segmented(segmented_layout_data* data) {
     if (!data)
         return;
 
+    prefetch_cancel(data);
+
     for (int i = 0; i < data->segment_count; i++) {
         reset_vgmstream(data->segments[i]);
     }
 
     data->current_segment = 0;
 }
+
+bool setup_layout_segmented_prefetch(segmented_layout_data* data, bool enable) {
+    segmented_prefetch_t* pf = data->prefetch;
+
+    if (pf) {
+        if (pf->thread) {
+            vgm_mutex_lock(pf->mutex);
+            pf->stop = true;
+            vgm_cond_broadcast(pf->cond);
+            vgm_mutex_unlock(pf->mutex);
+            vgm_thread_join(pf->thread);
+        }
+        vgm_cond_free(pf->cond);
+        vgm_mutex_free(pf->mutex);
+        free(pf->buffer);
+        free(pf);
+        data->prefetch = NULL;
+    }
+
+    if (!enable || data->segment_count <= 1)
+        return true;
+
+    pf = calloc(1, sizeof(segmented_prefetch_t));
+    if (!pf) goto fail;
+    data->prefetch = pf;
+
+    pf->segment = -1;
+
+    int max_sample_size = 0;
+    for (int i = 0; i < data->segment_count; i++) {
+        int current_sample_size = sfmt_get_sample_size( mixing_get_input_sample_type(data->segments[i]) );
+        if (max_sample_size < current_sample_size)
+            max_sample_size = current_sample_size;
+    }
+
+    pf->buffer = malloc(VGMSTREAM_SEGMENT_SAMPLE_BUFFER * data->input_channels * max_sample_size);
+    if (!pf->buffer) goto fail;
+
+    pf->mutex = vgm_mutex_init();
+    pf->cond = vgm_cond_init();
+    if (!pf->mutex || !pf->cond) goto fail;
+
+    pf->thread = vgm_thread_init(prefetch_worker, data);
+    if (!pf->thread) goto fail;
+
+    return true;
+fail:
+    setup_layout_segmented_prefetch(data, false);
+    return false;
+}
@@ -24,6 +24,17 @@
  * - some details described in the API may not happen at the moment (defined for future changes)
  * - uses long-winded libvgmstream_* names since internals alredy use the vgmstream_* 'namespace', #define as needed
  * - c-strings should be in UTF-8
+ *
+ * Threads:
+ * - different libvgmstream_t can be used from different threads at the same time without locks, as each keeps
+ *   its own state (decoders' lookup tables are constant, and the few shared caches/inits lock internally)
+ * - a single libvgmstream_t must only be used by one thread at a time (may move between threads)
+ * - libvgmstream_clone makes a separate libvgmstream_t of the same song, to play it from many threads
+ * - with async_samples set, a libvgmstream_t decodes in its own background thread; calls from the user are the same
+ *   (one thread at a time), and its libstreamfile_t is also read from that thread
+ * - custom libstreamfile_t must be safe to use from the thread that uses its libvgmstream_t (and from internal
+ *   threads if decode_threads is set)
+ * - log config is global: set it once before decoding; the callback may be called from any thread concurrently
  */
 
 
@@ -57,7 +68,7 @@
  * - vgmstream's features are mostly stable, but this API may be tweaked from time to time
  */
 #define LIBVGMSTREAM_API_VERSION_MAJOR 1    // breaking API/ABI changes
-#define LIBVGMSTREAM_API_VERSION_MINOR 0    // compatible API/ABI changes
+#define LIBVGMSTREAM_API_VERSION_MINOR 7    // compatible API/ABI changes
 #define LIBVGMSTREAM_API_VERSION_PATCH 0    // fixes
 
 /* Current API version, for dynamic checks. returns hex value: 0xMMmmpppp = MM-major, mm-minor, pppp-patch
@@ -67,13 +78,22 @@ LIBVGMSTREAM_API uint32_t libvgmstream_get_version(void);
 
 /* CHANGELOG:
  * - 1.0.0: initial version
+ * - 1.1.0: added decode_threads/decode_threads_mode/seek_index config (appended), added libvgmstream_setup_size
+ *          (libvgmstream_setup is now a macro passing the config's size; the old symbol still takes a 1.0.0 config)
+ * - 1.2.0: added block_samples config (appended) and libvgmstream_render_into
+ * - 1.3.0: added planar_output config (appended) and format's planar (appended)
+ * - 1.4.0: added resample_rate/resample_quality config (appended) and format's input_sample_rate (appended)
+ * - 1.5.0: added libvgmstream_clone
+ * - 1.6.0: added async_samples/async_watermark config (appended) and libvgmstream_read_async
+ * - 1.7.0: added clone_keep_file config (appended), libvgmstream_clone of formats that can't be copied needs it
  */
 
 
 /*****************************************************************************/
 /* DECODE */
 
-/* interleaved samples: buf[0]=ch0, buf[1]=ch1, buf[2]=ch0, buf[3]=ch0, ... */
+/* interleaved samples: buf[0]=ch0, buf[1]=ch1, buf[2]=ch0, buf[3]=ch0, ...
+ * (or planar if configured: buf[0..N-1]=ch0, buf[N..N*2-1]=ch1, ...) */
 typedef enum { 
     LIBVGMSTREAM_SAMPLE_PCM16   = 0x01,
     LIBVGMSTREAM_SAMPLE_PCM24   = 0x02,
@@ -81,11 +101,25 @@ typedef enum {
     LIBVGMSTREAM_SAMPLE_FLOAT   = 0x04,
 } libvgmstream_sample_t;
 
+/* parallel decoding modes (see decode_threads) */
+typedef enum {
+    LIBVGMSTREAM_THREADS_CHANNELS   = 0x01, // channel groups, for some simple codecs (DSP/PSX/ADX/IMA/PCM/etc) with many channels
+    LIBVGMSTREAM_THREADS_LAYERS     = 0x02, // each layer of layered files (some multi-stream formats and TXTP; only layers of codecs without external state)
+    LIBVGMSTREAM_THREADS_SEGMENTS   = 0x04, // starts decoding next segment of segmented files in the background (smoother changes; only segments of codecs without external state)
+} libvgmstream_threads_t;
+
+/* resampling quality presets (see resample_rate) */
+typedef enum {
+    LIBVGMSTREAM_RESAMPLE_FAST      = 0x01, // shorter filter, for slower devices
+    LIBVGMSTREAM_RESAMPLE_MEDIUM    = 0x02, // default
+    LIBVGMSTREAM_RESAMPLE_BEST      = 0x03, // longer filter, flatter response up to nyquist
+} libvgmstream_resample_t;
+
 /* current song info, may be copied around (values are info-only) */
 typedef struct {
     /* main (always set) */
     int channels;                           // output channels
-    int sample_rate;                        // output sample rate
+    int sample_rate;                        // output sample rate (after resampling, if configured)
 
     libvgmstream_sample_t sample_type;      // output buffer's sample type
     int sample_size;                        // derived from sample_type (pcm16=0x02, float=0x04, etc)
@@ -135,6 +169,11 @@ typedef struct {
     int format_id;                          // when reopening subfiles or similar formats without checking other all possible formats
                                             // ** this value WILL change without warning between vgmstream versions/commits
 
+    /* added in later versions (appended to keep offsets of older fields) */
+    bool planar;                            // output buffer is planar (see config's planar_output)
+    int input_sample_rate;                  // file's sample rate (stream_samples/loop points use this rate, while
+                                            // ** play_samples and positions use sample_rate)
+
 } libvgmstream_format_t;
 
 typedef struct {
@@ -190,14 +229,43 @@ typedef struct {
     bool force_pcm16;                       // forces output buffer to be remixed into PCM16
     bool force_float;                       // forces output buffer to be remixed into float
 
+    int decode_threads;                     // decodes in parallel using N threads (0/1 = disabled, -1 = all CPUs), output is the same
+                                            // ** custom libstreamfile_t must allow reading different opened files at once
+                                            // ** also used on _open to test keys of some encrypted formats (HCA) in parallel
+    int decode_threads_mode;                // what to decode in parallel (LIBVGMSTREAM_THREADS_* flags, 0 = all)
+
+    bool seek_index;                        // saves decoder state while decoding so seeking back is faster (uses some memory)
+                                            // ** only for some simple codecs (DSP/PSX/ADX/IMA/PCM/etc), others seek as usual
+
+    int block_samples;                      // max samples decoded per internal render (0 = default 1024)
+                                            // ** bigger blocks are a bit faster for batch conversion, smaller ones reduce latency
+
+    bool planar_output;                     // output buffers are planar (all samples of ch0, then all of ch1, ...) rather than interleaved
+                                            // ** channel N starts at N * buf_samples, where buf_samples is decoder's value with _render,
+                                            //    or the passed buf_samples with _fill/_render_into (meaning always the same offsets)
+
+    int resample_rate;                      // converts output to this sample rate (0 = file's sample rate)
+    int resample_quality;                   // LIBVGMSTREAM_RESAMPLE_* preset (0 = default)
+
+    int async_samples;                      // decodes ahead in a background thread into a buffer of N samples, read with _read_async (0 = disabled)
+                                            // ** for audio callbacks that can't wait for decoding or I/O; rounded up to a power of 2 (min 2 blocks)
+    int async_watermark;                    // background thread refills the buffer once buffered samples drop below this (0 = half the buffer)
+
+    bool clone_keep_file;                   // keeps the song's file open after _open, so libvgmstream_clone can parse it again
+                                            // ** only needed to clone formats that can't be copied (most with complex codecs/layouts)
+
 } libvgmstream_config_t;
 
 /* pass default config, that will be applied to song on open
  * - invalid config or complex cases (ex. some TXTP) may ignore these settings
  * - should be called without a song loaded (before _open or after _close)
  * - without config vgmstream will decode the current stream once
+ * - libvgmstream_setup passes the caller's sizeof(libvgmstream_config_t): new fields are only appended to the config,
+ *   so callers built with an older (smaller) config still work, and fields past their size are zeroed (defaults)
  */
-LIBVGMSTREAM_API void libvgmstream_setup(libvgmstream_t* lib, libvgmstream_config_t* cfg);
+LIBVGMSTREAM_API void libvgmstream_setup_size(libvgmstream_t* lib, libvgmstream_config_t* cfg, size_t cfg_size);
+LIBVGMSTREAM_API void libvgmstream_setup(libvgmstream_t* lib, libvgmstream_config_t* cfg); // 1.0.0 config only
+#define libvgmstream_setup(lib, cfg)  libvgmstream_setup_size(lib, cfg, sizeof(libvgmstream_config_t))
 
 
 /* configures how vgmstream opens the format */
@@ -224,6 +292,16 @@ LIBVGMSTREAM_API int libvgmstream_open_song(libvgmstream_t* lib, libvgmstream_op
  */
 LIBVGMSTREAM_API void libvgmstream_close_song(libvgmstream_t* lib);
 
+/* Creates a new context with the same config and song as lib, positioned at the start, that plays independently
+ * (for multiple listeners/voices of one song). Faster than opening again, as simple formats copy parsed data
+ * without reading the file's headers and complex ones only test the already detected format.
+ * - returns NULL on error (free with libvgmstream_free)
+ * - formats that can't be copied need config's clone_keep_file set before _open, or the clone fails
+ * - lib must not be used by other threads during the call
+ * - if no song is loaded the clone just copies the config
+ */
+LIBVGMSTREAM_API libvgmstream_t* libvgmstream_clone(libvgmstream_t* lib);
+
 
 /* Decodes next batch of samples
  * - vgmstream supplies its own buffer, updated on lib->decoder->* values (may change between calls)
@@ -238,6 +316,26 @@ LIBVGMSTREAM_API int libvgmstream_render(libvgmstream_t* lib);
  */
 LIBVGMSTREAM_API int libvgmstream_fill(libvgmstream_t* lib, void* buf, int buf_samples);
 
+/* Decodes up to buf_samples into an external buffer (also updates lib->decoder->* values, pointing to buf)
+ * - returns < 0 on error, or N = number of filled samples (less than buf_samples only when stream is done)
+ * - buf must be at least as big as channels * sample_size * buf_samples
+ * - decodes directly into buf without extra copies in most cases (when mixing doesn't need a bigger
+ *   buf than output, otherwise internal bufs are used), in chunks of config's block_samples
+ * - samples left by a previous _fill are returned first
+ */
+LIBVGMSTREAM_API int libvgmstream_render_into(libvgmstream_t* lib, void* buf, int buf_samples);
+
+/* Reads up to buf_samples decoded by the background thread (when async_samples is set) into an external buffer,
+ * without waiting for decoding (also updates lib->decoder->* values, pointing to buf)
+ * - returns < 0 on error, or N = number of read samples (may be 0 if the thread is behind, like right after
+ *   opening or seeking); lib->decoder->done is set once the stream is over
+ * - buf must be at least as big as channels * sample_size * buf_samples (planar output uses buf_samples as stride)
+ * - while async is active _render/_fill/_render_into return errors, and _seek/_reset are passed to the thread
+ *   (_get_play_position returns the position of the next read sample)
+ * - if async isn't enabled or threads aren't available, this decodes in place like _render_into
+ */
+LIBVGMSTREAM_API int libvgmstream_read_async(libvgmstream_t* lib, void* buf, int buf_samples);
+
 /* Gets current position within the song.
  * - return < 0 on error
  */
@@ -271,6 +369,8 @@ typedef struct {
 
 /* Defines a global log callback, as vgmstream sometimes communicates format issues to the user.
  * - note that log is currently set globally rather than per libvgmstream_t
+ * - should be set before opening songs, as changing it while other threads decode isn't synchronized
+ * - callback may be called from multiple threads (one per libvgmstream_t being decoded, plus internal threads)
 */
 LIBVGMSTREAM_API void libvgmstream_set_log(libvgmstream_log_t* cfg);
 
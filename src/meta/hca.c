@@ -13,7 +13,7 @@
   #endif
 #endif
 
-static int find_hca_key(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t subkey);
+static int find_hca_key(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t* p_subkey, int threads);
 
 
 /* CRI HCA - streamed audio from CRI ADX2/Atom middleware */
@@ -66,13 +66,13 @@ VGMSTREAM* init_vgmstream_hca_subkey(STREAMFILE* sf, uint16_t subkey) {
         }
 #ifdef HCA_BRUTEFORCE
         else if (1) {
-            int ok = find_hca_key(hca_data, &keycode, subkey);
+            int ok = find_hca_key(hca_data, &keycode, &subkey, sf->parse_threads);
             if (!ok)
                 bruteforce_hca_key(sf, hca_data, &keycode, subkey);
         }
 #endif
         else {
-            find_hca_key(hca_data, &keycode, subkey);
+            find_hca_key(hca_data, &keycode, &subkey, sf->parse_threads);
         }
 
         hca_set_encryption_key(hca_data, keycode, subkey);
@@ -136,40 +136,53 @@ fail:
 
 
 /* try to find the decryption key from a list */
-static int find_hca_key(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t subkey) {
+static int find_hca_key(hca_codec_data* hca_data, uint64_t* p_keycode, uint16_t* p_subkey, int threads) {
     const size_t keys_length = sizeof(hcakey_list) / sizeof(hcakey_list[0]);
-    int i;
+    uint64_t* keys = NULL;
+    uint16_t* subkeys = NULL;
+    int i, keys_count = 0, keys_max;
     hca_keytest_t hk = {0};
 
     hk.best_key = 0xCC55463930DBE1AB; /* defaults to PSO2 key, most common */ 
-    hk.subkey = subkey;
+    hk.best_subkey = *p_subkey;
+    hk.subkey = *p_subkey;
+
+    /* make a flat list of key+subkey candidates, that may be tested in parallel */
+    keys_max = keys_length;
+    if (*p_subkey == 0) {
+        for (i = 0; i < keys_length; i++) {
+            keys_max += hcakey_list[i].subkeys_size;
+        }
+    }
 
-    for (i = 0; i < keys_length; i++) {
-        hk.key = hcakey_list[i].key;
+    keys = malloc(keys_max * sizeof(uint64_t));
+    subkeys = malloc(keys_max * sizeof(uint16_t));
+    if (!keys || !subkeys) goto done;
 
-        test_hca_key(hca_data, &hk);
-        if (hk.best_score == 1)
-            goto done;
+    for (i = 0; i < keys_length; i++) {
+        keys[keys_count] = hcakey_list[i].key;
+        subkeys[keys_count] = *p_subkey;
+        keys_count++;
 
-#if 0
-        {
+        /* seed keys with a subkey table, when the file didn't provide a subkey */
+        if (hcakey_list[i].subkeys_size > 0 && *p_subkey == 0) {
             int j;
-            size_t subkeys_size = hcakey_list[i].subkeys_size;
-            const uint16_t* subkeys = hcakey_list[i].subkeys;
-            if (subkeys_size > 0 && subkey == 0) {
-                for (j = 0; j < subkeys_size; j++) {
-                    hk.subkey = subkeys[j];
-                    test_hca_key(hca_data, &hk);
-                    if (hk.best_score == 1)
-                        goto done;
-                }
+            for (j = 0; j < hcakey_list[i].subkeys_size; j++) {
+                keys[keys_count] = hcakey_list[i].key;
+                subkeys[keys_count] = hcakey_list[i].subkeys[j];
+                keys_count++;
             }
         }
-#endif
     }
 
+    test_hca_keys(hca_data, &hk, keys, subkeys, keys_count, threads);
+
 done:
+    free(keys);
+    free(subkeys);
+
     *p_keycode = hk.best_key;
+    *p_subkey = hk.best_subkey;
     VGM_ASSERT(hk.best_score > 1, "HCA: best key=%08x%08x (score=%i)\n",
             (uint32_t)((*p_keycode >> 32) & 0xFFFFFFFF), (uint32_t)(*p_keycode & 0xFFFFFFFF), hk.best_score);
     vgm_asserti(hk.best_score <= 0, "HCA: decryption key not found\n");
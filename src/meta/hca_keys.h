@@ -5,10 +5,8 @@
 
 typedef struct {
     uint64_t key;               /* hca key or seed ('user') key */
-#if 0
     const uint16_t* subkeys;    /* scramble subkey table for seed key */
     size_t subkeys_size;        /* size of the derivation subkey table */
-#endif
 } hcakey_info;
 
 
@@ -19,7 +17,7 @@ typedef struct {
  *
  * Some ACB+AWB after mid 2018 use a user seed key + a scramble subkey in the AWB (normally 16b LE at 0x0e)
  * to create the final HCA key, which means there is one key per AWB (so most HCA have a unique key).
- * vgmstream derives the key if subkey table is provided.
+ * vgmstream derives the key if subkey table is provided ({key, subkeys, subkeys_size}), tested when the file has no subkey.
  */
 static const hcakey_info hcakey_list[] = {
 
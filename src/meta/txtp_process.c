@@ -6,6 +6,7 @@
 #include "../base/mixing.h"
 #include "../base/plugins.h"
 #include "../util/layout_utils.h"
+#include "../util/threads.h"
 
 
 /*******************************************************************************/
@@ -473,8 +474,10 @@ static int make_group_random(txtp_header_t* txtp, txtp_group_t* grp, int positio
      * (plus foobar caches song duration unless .txtp is modifies, so it can get strange if randoms are too different) */
     if (selected < 0) {
         static int random_seed = 0;
+        vgm_global_lock(); /* rand() state is shared */
         srand((unsigned)txtp + random_seed++); /* whatevs */
         selected = (rand() % count); /* 0..count-1 */
+        vgm_global_unlock();
         //;VGM_LOG("TXTP: autoselected random %i\n", selected);
     }
 
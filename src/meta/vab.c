@@ -212,7 +212,7 @@ fail:
 
 /* Converts VAB note to PS1 pitch value (0-4096 where 4096 is 44100 Hz).
  * Function reversed from PS1 SDK. */
-static uint16_t _svm_ptable[] =
+static const uint16_t _svm_ptable[] =
 {
     4096, 4110, 4125, 4140, 4155, 4170, 4185, 4200,
     4216, 4231, 4246, 4261, 4277, 4292, 4308, 4323,
@@ -73,6 +73,9 @@ typedef struct _STREAMFILE {
      * Not ideal here, but it was the simplest way to pass to all init_vgmstream_x functions. */
     int stream_index; /* 0=default/auto (first), 1=first, N=Nth */
 
+    /* Threads allowed for slow parse-time work (like testing HCA keys), passed the same way. */
+    int parse_threads; /* 0/1=serial, N=up to N threads */
+
 } STREAMFILE;
 
 /* All open_ fuctions should be safe to call with wrong/null parameters.
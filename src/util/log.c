@@ -3,7 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 
-/* log context; should probably make a unique instance and pass to metas/decoders/etc, but for the time being use global */
+/* log context; should probably make a unique instance and pass to metas/decoders/etc, but for the time being use global
+ * (set once before decoding; logging itself may happen from any thread, so the callback must handle that) */
 //extern ...* log;
 
 typedef struct {
@@ -48,7 +49,9 @@ static void log_internal(void* ctx_p, int level, const char* fmt, va_list args)
     logger_t* ctx = ctx_p;
     if (!ctx) ctx = &log_impl;
 
-    if (!ctx->callback)
+    /* read once in case it's changed meanwhile */
+    void (*callback)(int level, const char* str) = ctx->callback;
+    if (!callback)
         return;
 
     if (level > ctx->level)
@@ -57,7 +60,7 @@ static void log_internal(void* ctx_p, int level, const char* fmt, va_list args)
     out = vsnprintf(line, sizeof(line), fmt, args);
     if (out < 0 || out > sizeof(line))
         strcpy(line, "(ignored log)"); //to-do something better, meh
-    ctx->callback(level, line);
+    callback(level, line);
 }
 
 void vgm_logd(const char* fmt, ...) {
@@ -0,0 +1,576 @@
+#include <math.h>
+#include "samples_ops.h"
+#include "../util.h"
+
+#if !defined(VGM_DISABLE_SIMD)
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SAMPLES_SSE2 1
+  #elif defined(__aarch64__) || defined(_M_ARM64)
+    /* ARMv8 only, since v7 lacks round-to-nearest conversions */
+    #include <arm_neon.h>
+    #define SAMPLES_NEON 1
+  #endif
+#endif
+
+/* planar inputs with more channels are converted in chunks and then interleaved */
+#define SAMPLES_PLANAR_CHUNK 256
+
+
+/* same as decoders' float_to_int */
+static inline int float_to_int(float val) {
+#if defined(_MSC_VER)
+    return (int)val;
+#else
+    return lrintf(val);
+#endif
+}
+
+static inline int16_t f32_to_s16(float val, float scale) {
+    return clamp16(float_to_int(val * scale));
+}
+
+/* same as sbuf's float_to_int (plain truncation) */
+static inline int16_t f32_to_s16_trunc(float val, float scale) {
+    return clamp16((int)(val * scale));
+}
+
+/* same as Xiph's decoder_example.c */
+static inline int16_t f32_to_s16_floor(float val, float scale) {
+    return clamp16((int)floor(val * scale + 0.5f));
+}
+
+
+#if defined(SAMPLES_SSE2)
+
+/* 8 floats > 8 s16; clamping first (rather than relying on packs) as out of range cvtps gives INT_MIN,
+ * and NaNs are zeroed (C's float_to_int truncates lrintf's LONG_MIN to 0) */
+static inline __m128i cvt8_f32_s16(const float* src, __m128 scale) {
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    __m128 v0 = _mm_mul_ps(_mm_loadu_ps(src + 0), scale);
+    __m128 v1 = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+    v0 = _mm_and_ps(v0, _mm_cmpord_ps(v0, v0));
+    v1 = _mm_and_ps(v1, _mm_cmpord_ps(v1, v1));
+    v0 = _mm_min_ps(_mm_max_ps(v0, lo), hi);
+    v1 = _mm_min_ps(_mm_max_ps(v1, lo), hi);
+#if defined(_MSC_VER)
+    return _mm_packs_epi32(_mm_cvttps_epi32(v0), _mm_cvttps_epi32(v1));
+#else
+    return _mm_packs_epi32(_mm_cvtps_epi32(v0), _mm_cvtps_epi32(v1));
+#endif
+}
+
+/* 8 floats > 8 s16 with truncation; NaNs become -32768 like x86's (int) casts */
+static inline __m128i cvt8_f32_s16_trunc(const float* src, __m128 scale) {
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    __m128 v0 = _mm_mul_ps(_mm_loadu_ps(src + 0), scale);
+    __m128 v1 = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+    v0 = _mm_min_ps(_mm_max_ps(v0, lo), hi);
+    v1 = _mm_min_ps(_mm_max_ps(v1, lo), hi);
+    return _mm_packs_epi32(_mm_cvttps_epi32(v0), _mm_cvttps_epi32(v1));
+}
+
+/* 8 floats > 8 s16 with floor(v + 0.5); NaNs become -32768 like x86's (int) casts */
+static inline __m128i cvt8_f32_s16_floor(const float* src, __m128 scale) {
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 v0 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + 0), scale), half);
+    __m128 v1 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + 4), scale), half);
+    v0 = _mm_min_ps(_mm_max_ps(v0, lo), hi);
+    v1 = _mm_min_ps(_mm_max_ps(v1, lo), hi);
+
+    /* floor = truncate, then -1 where truncation went up (negative non-integers) */
+    __m128i i0 = _mm_cvttps_epi32(v0);
+    __m128i i1 = _mm_cvttps_epi32(v1);
+    i0 = _mm_add_epi32(i0, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i0), v0)));
+    i1 = _mm_add_epi32(i1, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i1), v1)));
+    return _mm_packs_epi32(i0, i1);
+}
+
+#elif defined(SAMPLES_NEON)
+
+static inline int16x8_t cvt8_f32_s16(const float* src, float32x4_t scale) {
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+    float32x4_t v0 = vmulq_f32(vld1q_f32(src + 0), scale);
+    float32x4_t v1 = vmulq_f32(vld1q_f32(src + 4), scale);
+    v0 = vminq_f32(vmaxq_f32(v0, lo), hi); /* NaNs propagate and convert to 0, as in C */
+    v1 = vminq_f32(vmaxq_f32(v1, lo), hi);
+    return vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(v0)), vqmovn_s32(vcvtnq_s32_f32(v1)));
+}
+
+static inline int16x8_t cvt8_f32_s16_trunc(const float* src, float32x4_t scale) {
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+    float32x4_t v0 = vmulq_f32(vld1q_f32(src + 0), scale);
+    float32x4_t v1 = vmulq_f32(vld1q_f32(src + 4), scale);
+    v0 = vminq_f32(vmaxq_f32(v0, lo), hi);
+    v1 = vminq_f32(vmaxq_f32(v1, lo), hi);
+    return vcombine_s16(vqmovn_s32(vcvtq_s32_f32(v0)), vqmovn_s32(vcvtq_s32_f32(v1)));
+}
+
+static inline int16x8_t cvt8_f32_s16_floor(const float* src, float32x4_t scale) {
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    float32x4_t v0 = vaddq_f32(vmulq_f32(vld1q_f32(src + 0), scale), half);
+    float32x4_t v1 = vaddq_f32(vmulq_f32(vld1q_f32(src + 4), scale), half);
+    v0 = vminq_f32(vmaxq_f32(v0, lo), hi);
+    v1 = vminq_f32(vmaxq_f32(v1, lo), hi);
+    return vcombine_s16(vqmovn_s32(vcvtmq_s32_f32(v0)), vqmovn_s32(vcvtmq_s32_f32(v1)));
+}
+
+#endif
+
+
+void samples_f32_to_s16(int16_t* dst, const float* src, int count, float scale) {
+    int s = 0;
+
+#if defined(SAMPLES_SSE2)
+    __m128 vscale = _mm_set1_ps(scale);
+    for (; s + 8 <= count; s += 8) {
+        _mm_storeu_si128((__m128i*)(dst + s), cvt8_f32_s16(src + s, vscale));
+    }
+#elif defined(SAMPLES_NEON)
+    float32x4_t vscale = vdupq_n_f32(scale);
+    for (; s + 8 <= count; s += 8) {
+        vst1q_s16(dst + s, cvt8_f32_s16(src + s, vscale));
+    }
+#endif
+
+    for (; s < count; s++) {
+        dst[s] = f32_to_s16(src[s], scale);
+    }
+}
+
+void samples_f32p_to_s16(int16_t* dst, float** src, int channels, int skip, int samples, float scale) {
+    int s, ch;
+
+    if (channels == 1) {
+        samples_f32_to_s16(dst, src[0] + skip, samples, scale);
+        return;
+    }
+
+    if (channels == 2) {
+        const float* src_l = src[0] + skip;
+        const float* src_r = src[1] + skip;
+        s = 0;
+
+#if defined(SAMPLES_SSE2)
+        {
+            __m128 vscale = _mm_set1_ps(scale);
+            for (; s + 8 <= samples; s += 8) {
+                __m128i l = cvt8_f32_s16(src_l + s, vscale);
+                __m128i r = cvt8_f32_s16(src_r + s, vscale);
+                _mm_storeu_si128((__m128i*)(dst + s * 2 + 0), _mm_unpacklo_epi16(l, r));
+                _mm_storeu_si128((__m128i*)(dst + s * 2 + 8), _mm_unpackhi_epi16(l, r));
+            }
+        }
+#elif defined(SAMPLES_NEON)
+        {
+            float32x4_t vscale = vdupq_n_f32(scale);
+            for (; s + 8 <= samples; s += 8) {
+                int16x8x2_t lr;
+                lr.val[0] = cvt8_f32_s16(src_l + s, vscale);
+                lr.val[1] = cvt8_f32_s16(src_r + s, vscale);
+                vst2q_s16(dst + s * 2, lr);
+            }
+        }
+#endif
+
+        for (; s < samples; s++) {
+            dst[s * 2 + 0] = f32_to_s16(src_l[s], scale);
+            dst[s * 2 + 1] = f32_to_s16(src_r[s], scale);
+        }
+        return;
+    }
+
+    /* convert each plane linearly (vectorized) then scatter, rather than jumping between planes per sample */
+    {
+        int16_t tmp[SAMPLES_PLANAR_CHUNK];
+        int done = 0;
+
+        while (done < samples) {
+            int to_do = samples - done;
+            if (to_do > SAMPLES_PLANAR_CHUNK)
+                to_do = SAMPLES_PLANAR_CHUNK;
+
+            for (ch = 0; ch < channels; ch++) {
+                int16_t* out = dst + done * channels + ch;
+
+                samples_f32_to_s16(tmp, src[ch] + skip + done, to_do, scale);
+                for (s = 0; s < to_do; s++) {
+                    out[s * channels] = tmp[s];
+                }
+            }
+
+            done += to_do;
+        }
+    }
+}
+
+
+void samples_f32_to_s16_trunc(int16_t* dst, const float* src, int count, float scale) {
+    int s = 0;
+
+#if defined(SAMPLES_SSE2)
+    __m128 vscale = _mm_set1_ps(scale);
+    for (; s + 8 <= count; s += 8) {
+        _mm_storeu_si128((__m128i*)(dst + s), cvt8_f32_s16_trunc(src + s, vscale));
+    }
+#elif defined(SAMPLES_NEON)
+    float32x4_t vscale = vdupq_n_f32(scale);
+    for (; s + 8 <= count; s += 8) {
+        vst1q_s16(dst + s, cvt8_f32_s16_trunc(src + s, vscale));
+    }
+#endif
+
+    for (; s < count; s++) {
+        dst[s] = f32_to_s16_trunc(src[s], scale);
+    }
+}
+
+void samples_f32_to_s16_floor(int16_t* dst, const float* src, int count, float scale) {
+    int s = 0;
+
+#if defined(SAMPLES_SSE2)
+    __m128 vscale = _mm_set1_ps(scale);
+    for (; s + 8 <= count; s += 8) {
+        _mm_storeu_si128((__m128i*)(dst + s), cvt8_f32_s16_floor(src + s, vscale));
+    }
+#elif defined(SAMPLES_NEON)
+    float32x4_t vscale = vdupq_n_f32(scale);
+    for (; s + 8 <= count; s += 8) {
+        vst1q_s16(dst + s, cvt8_f32_s16_floor(src + s, vscale));
+    }
+#endif
+
+    for (; s < count; s++) {
+        dst[s] = f32_to_s16_floor(src[s], scale);
+    }
+}
+
+void samples_f32p_to_s16_floor(int16_t* dst, float** src, int channels, int skip, int samples, float scale) {
+    int s, ch;
+
+    if (channels == 1) {
+        samples_f32_to_s16_floor(dst, src[0] + skip, samples, scale);
+        return;
+    }
+
+    if (channels == 2) {
+        const float* src_l = src[0] + skip;
+        const float* src_r = src[1] + skip;
+        s = 0;
+
+#if defined(SAMPLES_SSE2)
+        {
+            __m128 vscale = _mm_set1_ps(scale);
+            for (; s + 8 <= samples; s += 8) {
+                __m128i l = cvt8_f32_s16_floor(src_l + s, vscale);
+                __m128i r = cvt8_f32_s16_floor(src_r + s, vscale);
+                _mm_storeu_si128((__m128i*)(dst + s * 2 + 0), _mm_unpacklo_epi16(l, r));
+                _mm_storeu_si128((__m128i*)(dst + s * 2 + 8), _mm_unpackhi_epi16(l, r));
+            }
+        }
+#elif defined(SAMPLES_NEON)
+        {
+            float32x4_t vscale = vdupq_n_f32(scale);
+            for (; s + 8 <= samples; s += 8) {
+                int16x8x2_t lr;
+                lr.val[0] = cvt8_f32_s16_floor(src_l + s, vscale);
+                lr.val[1] = cvt8_f32_s16_floor(src_r + s, vscale);
+                vst2q_s16(dst + s * 2, lr);
+            }
+        }
+#endif
+
+        for (; s < samples; s++) {
+            dst[s * 2 + 0] = f32_to_s16_floor(src_l[s], scale);
+            dst[s * 2 + 1] = f32_to_s16_floor(src_r[s], scale);
+        }
+        return;
+    }
+
+    {
+        int16_t tmp[SAMPLES_PLANAR_CHUNK];
+        int done = 0;
+
+        while (done < samples) {
+            int to_do = samples - done;
+            if (to_do > SAMPLES_PLANAR_CHUNK)
+                to_do = SAMPLES_PLANAR_CHUNK;
+
+            for (ch = 0; ch < channels; ch++) {
+                int16_t* out = dst + done * channels + ch;
+
+                samples_f32_to_s16_floor(tmp, src[ch] + skip + done, to_do, scale);
+                for (s = 0; s < to_do; s++) {
+                    out[s * channels] = tmp[s];
+                }
+            }
+
+            done += to_do;
+        }
+    }
+}
+
+
+void samples_s16_to_f32(float* dst, const int16_t* src, int count) {
+    int s = 0;
+
+#if defined(SAMPLES_SSE2)
+    for (; s + 8 <= count; s += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + s));
+        /* sign-extend by moving each s16 to the upper half then shifting back */
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + s + 0, _mm_cvtepi32_ps(lo));
+        _mm_storeu_ps(dst + s + 4, _mm_cvtepi32_ps(hi));
+    }
+#elif defined(SAMPLES_NEON)
+    for (; s + 8 <= count; s += 8) {
+        int16x8_t v = vld1q_s16(src + s);
+        vst1q_f32(dst + s + 0, vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))));
+        vst1q_f32(dst + s + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))));
+    }
+#endif
+
+    for (; s < count; s++) {
+        dst[s] = (float)src[s];
+    }
+}
+
+void samples_f32_scale(float* dst, const float* src, int count, float scale) {
+    int s = 0;
+
+#if defined(SAMPLES_SSE2)
+    __m128 vscale = _mm_set1_ps(scale);
+    for (; s + 4 <= count; s += 4) {
+        _mm_storeu_ps(dst + s, _mm_mul_ps(_mm_loadu_ps(src + s), vscale));
+    }
+#elif defined(SAMPLES_NEON)
+    float32x4_t vscale = vdupq_n_f32(scale);
+    for (; s + 4 <= count; s += 4) {
+        vst1q_f32(dst + s, vmulq_f32(vld1q_f32(src + s), vscale));
+    }
+#endif
+
+    for (; s < count; s++) {
+        dst[s] = src[s] * scale;
+    }
+}
+
+
+void samples_s16p_to_s16(int16_t* dst, int16_t** src, int channels, int skip, int samples) {
+    int s, ch;
+
+    if (channels == 2) {
+        const int16_t* src_l = src[0] + skip;
+        const int16_t* src_r = src[1] + skip;
+        s = 0;
+
+#if defined(SAMPLES_SSE2)
+        for (; s + 8 <= samples; s += 8) {
+            __m128i l = _mm_loadu_si128((const __m128i*)(src_l + s));
+            __m128i r = _mm_loadu_si128((const __m128i*)(src_r + s));
+            _mm_storeu_si128((__m128i*)(dst + s * 2 + 0), _mm_unpacklo_epi16(l, r));
+            _mm_storeu_si128((__m128i*)(dst + s * 2 + 8), _mm_unpackhi_epi16(l, r));
+        }
+#elif defined(SAMPLES_NEON)
+        for (; s + 8 <= samples; s += 8) {
+            int16x8x2_t lr;
+            lr.val[0] = vld1q_s16(src_l + s);
+            lr.val[1] = vld1q_s16(src_r + s);
+            vst2q_s16(dst + s * 2, lr);
+        }
+#endif
+
+        for (; s < samples; s++) {
+            dst[s * 2 + 0] = src_l[s];
+            dst[s * 2 + 1] = src_r[s];
+        }
+        return;
+    }
+
+    for (ch = 0; ch < channels; ch++) {
+        const int16_t* in = src[ch] + skip;
+        int16_t* out = dst + ch;
+        for (s = 0; s < samples; s++) {
+            out[s * channels] = in[s];
+        }
+    }
+}
+
+
+/* reverse of the above (interleaved to planar), for planar output */
+void samples_s16_to_s16p(int16_t** dst, const int16_t* src, int channels, int skip, int samples) {
+    int s, ch;
+
+    if (channels == 2) {
+        int16_t* dst_l = dst[0] + skip;
+        int16_t* dst_r = dst[1] + skip;
+        s = 0;
+
+#if defined(SAMPLES_SSE2)
+        for (; s + 8 <= samples; s += 8) {
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(src + s * 2 + 0));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(src + s * 2 + 8));
+            /* sign-extend each L (low half) and R (high half) to 32b then pack back (always in range) */
+            __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(v0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16));
+            __m128i r = _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16));
+            _mm_storeu_si128((__m128i*)(dst_l + s), l);
+            _mm_storeu_si128((__m128i*)(dst_r + s), r);
+        }
+#elif defined(SAMPLES_NEON)
+        for (; s + 8 <= samples; s += 8) {
+            int16x8x2_t lr = vld2q_s16(src + s * 2);
+            vst1q_s16(dst_l + s, lr.val[0]);
+            vst1q_s16(dst_r + s, lr.val[1]);
+        }
+#endif
+
+        for (; s < samples; s++) {
+            dst_l[s] = src[s * 2 + 0];
+            dst_r[s] = src[s * 2 + 1];
+        }
+        return;
+    }
+
+    for (ch = 0; ch < channels; ch++) {
+        const int16_t* in = src + ch;
+        int16_t* out = dst[ch] + skip;
+        for (s = 0; s < samples; s++) {
+            out[s] = in[s * channels];
+        }
+    }
+}
+
+void samples_f32_to_f32p(float** dst, const float* src, int channels, int skip, int samples) {
+    int s, ch;
+
+    if (channels == 2) {
+        float* dst_l = dst[0] + skip;
+        float* dst_r = dst[1] + skip;
+        s = 0;
+
+#if defined(SAMPLES_SSE2)
+        for (; s + 4 <= samples; s += 4) {
+            __m128 v0 = _mm_loadu_ps(src + s * 2 + 0);
+            __m128 v1 = _mm_loadu_ps(src + s * 2 + 4);
+            _mm_storeu_ps(dst_l + s, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(dst_r + s, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+#elif defined(SAMPLES_NEON)
+        for (; s + 4 <= samples; s += 4) {
+            float32x4x2_t lr = vld2q_f32(src + s * 2);
+            vst1q_f32(dst_l + s, lr.val[0]);
+            vst1q_f32(dst_r + s, lr.val[1]);
+        }
+#endif
+
+        for (; s < samples; s++) {
+            dst_l[s] = src[s * 2 + 0];
+            dst_r[s] = src[s * 2 + 1];
+        }
+        return;
+    }
+
+    for (ch = 0; ch < channels; ch++) {
+        const float* in = src + ch;
+        float* out = dst[ch] + skip;
+        for (s = 0; s < samples; s++) {
+            out[s] = in[s * channels];
+        }
+    }
+}
+
+void samples_s32_to_s16(int16_t* dst, const int32_t* src, int count) {
+    int s = 0;
+
+#if defined(SAMPLES_SSE2)
+    for (; s + 8 <= count; s += 8) {
+        __m128i v0 = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(src + s + 0)), 16);
+        __m128i v1 = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(src + s + 4)), 16);
+        _mm_storeu_si128((__m128i*)(dst + s), _mm_packs_epi32(v0, v1));
+    }
+#elif defined(SAMPLES_NEON)
+    for (; s + 8 <= count; s += 8) {
+        int16x4_t v0 = vshrn_n_s32(vld1q_s32(src + s + 0), 16);
+        int16x4_t v1 = vshrn_n_s32(vld1q_s32(src + s + 4), 16);
+        vst1q_s16(dst + s, vcombine_s16(v0, v1));
+    }
+#endif
+
+    for (; s < count; s++) {
+        dst[s] = src[s] >> 16;
+    }
+}
+
+void samples_s32p_to_s16(int16_t* dst, int32_t** src, int channels, int skip, int samples) {
+    int16_t tmp[SAMPLES_PLANAR_CHUNK];
+    int s, ch, done = 0;
+
+    if (channels == 1) {
+        samples_s32_to_s16(dst, src[0] + skip, samples);
+        return;
+    }
+
+    while (done < samples) {
+        int to_do = samples - done;
+        if (to_do > SAMPLES_PLANAR_CHUNK)
+            to_do = SAMPLES_PLANAR_CHUNK;
+
+        for (ch = 0; ch < channels; ch++) {
+            int16_t* out = dst + done * channels + ch;
+
+            samples_s32_to_s16(tmp, src[ch] + skip + done, to_do);
+            for (s = 0; s < to_do; s++) {
+                out[s * channels] = tmp[s];
+            }
+        }
+
+        done += to_do;
+    }
+}
+
+
+/* 4 partial sums added as (0+2)+(1+3) in all versions, so SIMD and plain C should give the same result */
+float samples_f32_dot(const float* a, const float* b, int count) {
+    int i = 0;
+    float sum;
+
+#if defined(SAMPLES_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    sum = _mm_cvtss_f32(acc);
+#elif defined(SAMPLES_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4) {
+        acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    float32x2_t half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(half, 0) + vget_lane_f32(half, 1);
+#else
+    float acc[4] = {0};
+    for (; i + 4 <= count; i += 4) {
+        acc[0] += a[i + 0] * b[i + 0];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+    sum = (acc[0] + acc[2]) + (acc[1] + acc[3]);
+#endif
+
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
@@ -0,0 +1,36 @@
+#ifndef _UTIL_SAMPLES_OPS_H
+#define _UTIL_SAMPLES_OPS_H
+
+#include <stdint.h>
+
+/* Sample format conversion kernels, vectorized (SSE2/NEON) when the target allows it. Notes:
+ * - float to s16 rounds like vgmstream's float_to_int (lrintf, or truncation on MSVC) then clamps,
+ *   so SIMD and plain C give the same output
+ * - planar ("p") inputs are arrays of per-channel buffers, starting at sample 'skip', and are
+ *   interleaved into dst (dst[s * channels + ch]); planar outputs do the reverse (writing from 'skip')
+ * - "_floor" variants round with floor(val * scale + 0.5) instead, as Xiph's examples (used by Vorbis),
+ *   and "_trunc" variants truncate like a (int) cast (used by sbuf and the resampler)
+ * - define VGM_DISABLE_SIMD to use plain C
+ */
+
+void samples_f32_to_s16(int16_t* dst, const float* src, int count, float scale);
+void samples_f32p_to_s16(int16_t* dst, float** src, int channels, int skip, int samples, float scale);
+
+void samples_f32_to_s16_trunc(int16_t* dst, const float* src, int count, float scale);
+void samples_f32_to_s16_floor(int16_t* dst, const float* src, int count, float scale);
+void samples_f32p_to_s16_floor(int16_t* dst, float** src, int channels, int skip, int samples, float scale);
+
+void samples_s16_to_f32(float* dst, const int16_t* src, int count);
+void samples_f32_scale(float* dst, const float* src, int count, float scale);
+
+void samples_s16p_to_s16(int16_t* dst, int16_t** src, int channels, int skip, int samples);
+void samples_s16_to_s16p(int16_t** dst, const int16_t* src, int channels, int skip, int samples);
+void samples_f32_to_f32p(float** dst, const float* src, int channels, int skip, int samples);
+
+void samples_s32_to_s16(int16_t* dst, const int32_t* src, int count);
+void samples_s32p_to_s16(int16_t* dst, int32_t** src, int channels, int skip, int samples);
+
+/* sum of a[i] * b[i] (for FIR filters) */
+float samples_f32_dot(const float* a, const float* b, int count);
+
+#endif
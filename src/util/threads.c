@@ -0,0 +1,448 @@
+#include <stdlib.h>
+#include "threads.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+    #if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0600
+        #define VGM_THREADS_WIN32
+    #endif
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define VGM_THREADS_PTHREAD
+#endif
+
+#define VGM_POOL_MAX_THREADS 64
+
+
+#if defined(VGM_THREADS_WIN32)
+
+struct vgm_mutex_t { CRITICAL_SECTION cs; };
+struct vgm_cond_t { CONDITION_VARIABLE cv; };
+struct vgm_thread_t { HANDLE handle; void (*fn)(void* arg); void* arg; };
+
+bool vgm_threads_available(void) {
+    return true;
+}
+
+int vgm_threads_get_cpus(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+vgm_mutex_t* vgm_mutex_init(void) {
+    vgm_mutex_t* mutex = malloc(sizeof(vgm_mutex_t));
+    if (!mutex) return NULL;
+    InitializeCriticalSection(&mutex->cs);
+    return mutex;
+}
+
+void vgm_mutex_free(vgm_mutex_t* mutex) {
+    if (!mutex) return;
+    DeleteCriticalSection(&mutex->cs);
+    free(mutex);
+}
+
+void vgm_mutex_lock(vgm_mutex_t* mutex) {
+    EnterCriticalSection(&mutex->cs);
+}
+
+void vgm_mutex_unlock(vgm_mutex_t* mutex) {
+    LeaveCriticalSection(&mutex->cs);
+}
+
+vgm_cond_t* vgm_cond_init(void) {
+    vgm_cond_t* cond = malloc(sizeof(vgm_cond_t));
+    if (!cond) return NULL;
+    InitializeConditionVariable(&cond->cv);
+    return cond;
+}
+
+void vgm_cond_free(vgm_cond_t* cond) {
+    free(cond); /* no destroy needed */
+}
+
+void vgm_cond_wait(vgm_cond_t* cond, vgm_mutex_t* mutex) {
+    SleepConditionVariableCS(&cond->cv, &mutex->cs, INFINITE);
+}
+
+void vgm_cond_signal(vgm_cond_t* cond) {
+    WakeConditionVariable(&cond->cv);
+}
+
+void vgm_cond_broadcast(vgm_cond_t* cond) {
+    WakeAllConditionVariable(&cond->cv);
+}
+
+static SRWLOCK g_global_lock = SRWLOCK_INIT;
+
+void vgm_global_lock(void) {
+    AcquireSRWLockExclusive(&g_global_lock);
+}
+
+void vgm_global_unlock(void) {
+    ReleaseSRWLockExclusive(&g_global_lock);
+}
+
+static DWORD WINAPI thread_main(LPVOID arg) {
+    vgm_thread_t* thread = arg;
+    thread->fn(thread->arg);
+    return 0;
+}
+
+vgm_thread_t* vgm_thread_init(void (*fn)(void* arg), void* arg) {
+    vgm_thread_t* thread = malloc(sizeof(vgm_thread_t));
+    if (!thread) return NULL;
+
+    thread->fn = fn;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, thread_main, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void vgm_thread_join(vgm_thread_t* thread) {
+    if (!thread) return;
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+#elif defined(VGM_THREADS_PTHREAD)
+
+struct vgm_mutex_t { pthread_mutex_t mutex; };
+struct vgm_cond_t { pthread_cond_t cond; };
+struct vgm_thread_t { pthread_t thread; void (*fn)(void* arg); void* arg; };
+
+bool vgm_threads_available(void) {
+    return true;
+}
+
+int vgm_threads_get_cpus(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+#else
+    return 1;
+#endif
+}
+
+vgm_mutex_t* vgm_mutex_init(void) {
+    vgm_mutex_t* mutex = malloc(sizeof(vgm_mutex_t));
+    if (!mutex) return NULL;
+    if (pthread_mutex_init(&mutex->mutex, NULL) != 0) {
+        free(mutex);
+        return NULL;
+    }
+    return mutex;
+}
+
+void vgm_mutex_free(vgm_mutex_t* mutex) {
+    if (!mutex) return;
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+void vgm_mutex_lock(vgm_mutex_t* mutex) {
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void vgm_mutex_unlock(vgm_mutex_t* mutex) {
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+vgm_cond_t* vgm_cond_init(void) {
+    vgm_cond_t* cond = malloc(sizeof(vgm_cond_t));
+    if (!cond) return NULL;
+    if (pthread_cond_init(&cond->cond, NULL) != 0) {
+        free(cond);
+        return NULL;
+    }
+    return cond;
+}
+
+void vgm_cond_free(vgm_cond_t* cond) {
+    if (!cond) return;
+    pthread_cond_destroy(&cond->cond);
+    free(cond);
+}
+
+void vgm_cond_wait(vgm_cond_t* cond, vgm_mutex_t* mutex) {
+    pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+void vgm_cond_signal(vgm_cond_t* cond) {
+    pthread_cond_signal(&cond->cond);
+}
+
+void vgm_cond_broadcast(vgm_cond_t* cond) {
+    pthread_cond_broadcast(&cond->cond);
+}
+
+static pthread_mutex_t g_global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void vgm_global_lock(void) {
+    pthread_mutex_lock(&g_global_lock);
+}
+
+void vgm_global_unlock(void) {
+    pthread_mutex_unlock(&g_global_lock);
+}
+
+static void* thread_main(void* arg) {
+    vgm_thread_t* thread = arg;
+    thread->fn(thread->arg);
+    return NULL;
+}
+
+vgm_thread_t* vgm_thread_init(void (*fn)(void* arg), void* arg) {
+    vgm_thread_t* thread = malloc(sizeof(vgm_thread_t));
+    if (!thread) return NULL;
+
+    thread->fn = fn;
+    thread->arg = arg;
+    if (pthread_create(&thread->thread, NULL, thread_main, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void vgm_thread_join(vgm_thread_t* thread) {
+    if (!thread) return;
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
+
+#else
+
+/* no threads: everything fails and callers must go serial */
+bool vgm_threads_available(void) { return false; }
+int vgm_threads_get_cpus(void) { return 1; }
+
+vgm_mutex_t* vgm_mutex_init(void) { return NULL; }
+void vgm_mutex_free(vgm_mutex_t* mutex) { }
+void vgm_mutex_lock(vgm_mutex_t* mutex) { }
+void vgm_mutex_unlock(vgm_mutex_t* mutex) { }
+
+#if defined(_WIN32)
+/* threads can't be created here but the host may still call from multiple threads */
+static volatile LONG g_global_lock = 0;
+
+void vgm_global_lock(void) {
+    while (InterlockedExchange(&g_global_lock, 1) != 0) {
+        Sleep(0);
+    }
+}
+
+void vgm_global_unlock(void) {
+    InterlockedExchange(&g_global_lock, 0);
+}
+#else
+void vgm_global_lock(void) { }
+void vgm_global_unlock(void) { }
+#endif
+
+vgm_cond_t* vgm_cond_init(void) { return NULL; }
+void vgm_cond_free(vgm_cond_t* cond) { }
+void vgm_cond_wait(vgm_cond_t* cond, vgm_mutex_t* mutex) { }
+void vgm_cond_signal(vgm_cond_t* cond) { }
+void vgm_cond_broadcast(vgm_cond_t* cond) { }
+
+vgm_thread_t* vgm_thread_init(void (*fn)(void* arg), void* arg) { return NULL; }
+void vgm_thread_join(vgm_thread_t* thread) { }
+
+#endif
+
+
+/* ************************************************************************* */
+
+#if defined(_WIN32)
+bool vgm_atomics_available(void) {
+    return true;
+}
+
+int vgm_atomic_get(volatile int* value) {
+    return InterlockedCompareExchange((volatile LONG*)value, 0, 0);
+}
+
+void vgm_atomic_set(volatile int* value, int new_value) {
+    InterlockedExchange((volatile LONG*)value, new_value);
+}
+#elif defined(__GNUC__) || defined(__clang__)
+bool vgm_atomics_available(void) {
+    return true;
+}
+
+int vgm_atomic_get(volatile int* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+void vgm_atomic_set(volatile int* value, int new_value) {
+    __atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+#else
+/* unknown compiler: no barriers, so not usable between threads (plain accesses for serial callers) */
+bool vgm_atomics_available(void) {
+    return false;
+}
+
+int vgm_atomic_get(volatile int* value) {
+    return *value;
+}
+
+void vgm_atomic_set(volatile int* value, int new_value) {
+    *value = new_value;
+}
+#endif
+
+
+/* ************************************************************************* */
+
+struct vgm_pool_t {
+    vgm_thread_t* workers[VGM_POOL_MAX_THREADS];
+    int num_workers;
+
+    vgm_mutex_t* mutex;
+    vgm_cond_t* cond_work;      /* signals workers that jobs are ready (or stop) */
+    vgm_cond_t* cond_done;      /* signals caller that all jobs are done */
+
+    /* current run (protected by mutex) */
+    void (*fn)(void* ctx, int index);
+    void* ctx;
+    int count;                  /* jobs in current run */
+    int next;                   /* next job index to take */
+    int done;                   /* finished jobs */
+    bool busy;                  /* a run is in progress */
+    bool stop;
+};
+
+/* takes and runs jobs until none are left; called with mutex locked and returns locked */
+static void pool_do_jobs(vgm_pool_t* pool) {
+    while (pool->next < pool->count) {
+        int index = pool->next++;
+        void (*fn)(void* ctx, int index) = pool->fn;
+        void* ctx = pool->ctx;
+
+        vgm_mutex_unlock(pool->mutex);
+        fn(ctx, index);
+        vgm_mutex_lock(pool->mutex);
+
+        pool->done++;
+        if (pool->done == pool->count)
+            vgm_cond_signal(pool->cond_done);
+    }
+}
+
+static void pool_worker(void* arg) {
+    vgm_pool_t* pool = arg;
+
+    vgm_mutex_lock(pool->mutex);
+    while (true) {
+        while (!pool->stop && pool->next >= pool->count) {
+            vgm_cond_wait(pool->cond_work, pool->mutex);
+        }
+        if (pool->stop)
+            break;
+
+        pool_do_jobs(pool);
+    }
+    vgm_mutex_unlock(pool->mutex);
+}
+
+vgm_pool_t* vgm_pool_init(int threads) {
+    vgm_pool_t* pool = NULL;
+
+    if (threads < 2 || !vgm_threads_available())
+        return NULL;
+    if (threads > VGM_POOL_MAX_THREADS)
+        threads = VGM_POOL_MAX_THREADS;
+
+    pool = calloc(1, sizeof(vgm_pool_t));
+    if (!pool) goto fail;
+
+    pool->mutex = vgm_mutex_init();
+    pool->cond_work = vgm_cond_init();
+    pool->cond_done = vgm_cond_init();
+    if (!pool->mutex || !pool->cond_work || !pool->cond_done) goto fail;
+
+    for (int i = 0; i < threads - 1; i++) {
+        pool->workers[i] = vgm_thread_init(pool_worker, pool);
+        if (!pool->workers[i]) goto fail;
+        pool->num_workers++;
+    }
+
+    return pool;
+fail:
+    vgm_pool_free(pool);
+    return NULL;
+}
+
+void vgm_pool_free(vgm_pool_t* pool) {
+    if (!pool)
+        return;
+
+    if (pool->mutex) {
+        vgm_mutex_lock(pool->mutex);
+        pool->stop = true;
+        if (pool->cond_work)
+            vgm_cond_broadcast(pool->cond_work);
+        vgm_mutex_unlock(pool->mutex);
+    }
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        vgm_thread_join(pool->workers[i]);
+    }
+
+    vgm_cond_free(pool->cond_done);
+    vgm_cond_free(pool->cond_work);
+    vgm_mutex_free(pool->mutex);
+    free(pool);
+}
+
+int vgm_pool_get_threads(vgm_pool_t* pool) {
+    if (!pool)
+        return 1;
+    return pool->num_workers + 1;
+}
+
+void vgm_pool_run(vgm_pool_t* pool, int count, void (*fn)(void* ctx, int index), void* ctx) {
+    if (count <= 0)
+        return;
+
+    if (pool) {
+        vgm_mutex_lock(pool->mutex);
+        if (!pool->busy) {
+            pool->busy = true;
+            pool->fn = fn;
+            pool->ctx = ctx;
+            pool->count = count;
+            pool->next = 0;
+            pool->done = 0;
+            if (count > 1)
+                vgm_cond_broadcast(pool->cond_work);
+
+            /* caller works too, then waits for jobs taken by workers */
+            pool_do_jobs(pool);
+            while (pool->done < pool->count) {
+                vgm_cond_wait(pool->cond_done, pool->mutex);
+            }
+
+            pool->count = 0;
+            pool->next = 0;
+            pool->busy = false;
+            vgm_mutex_unlock(pool->mutex);
+            return;
+        }
+        vgm_mutex_unlock(pool->mutex);
+    }
+
+    /* no pool or already in use */
+    for (int i = 0; i < count; i++) {
+        fn(ctx, i);
+    }
+}
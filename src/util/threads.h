@@ -0,0 +1,65 @@
+#ifndef _UTIL_THREADS_H
+#define _UTIL_THREADS_H
+
+#include <stdbool.h>
+
+/* Minimal portable threading utils. Notes:
+ * - backends: pthreads, or Win32 Vista+ (needs CONDITION_VARIABLE); other targets have no threads
+ * - when threads aren't available inits return NULL/false and callers are expected to work serially
+ * - only what vgmstream needs, not meant to be a general lib
+ */
+
+typedef struct vgm_mutex_t vgm_mutex_t;
+typedef struct vgm_cond_t vgm_cond_t;
+typedef struct vgm_thread_t vgm_thread_t;
+
+/* true if this build can create threads at all */
+bool vgm_threads_available(void);
+
+/* number of logical CPUs (1 if unknown) */
+int vgm_threads_get_cpus(void);
+
+
+vgm_mutex_t* vgm_mutex_init(void);
+void vgm_mutex_free(vgm_mutex_t* mutex);
+void vgm_mutex_lock(vgm_mutex_t* mutex);
+void vgm_mutex_unlock(vgm_mutex_t* mutex);
+
+vgm_cond_t* vgm_cond_init(void);
+void vgm_cond_free(vgm_cond_t* cond);
+/* must be called with mutex locked; may wake up spuriously so check conditions in a loop */
+void vgm_cond_wait(vgm_cond_t* cond, vgm_mutex_t* mutex);
+void vgm_cond_signal(vgm_cond_t* cond);
+void vgm_cond_broadcast(vgm_cond_t* cond);
+
+/* process-wide lock for small shared state like global caches (no init needed; don't nest) */
+void vgm_global_lock(void);
+void vgm_global_unlock(void);
+
+/* atomic int read/write with full barriers, for lock-free state shared between threads (like ring buffer positions)
+ * - returns false with unknown compilers, where get/set are plain accesses and lock-free callers must work serially */
+bool vgm_atomics_available(void);
+int vgm_atomic_get(volatile int* value);
+void vgm_atomic_set(volatile int* value, int new_value);
+
+vgm_thread_t* vgm_thread_init(void (*fn)(void* arg), void* arg);
+/* waits for thread end and frees it */
+void vgm_thread_join(vgm_thread_t* thread);
+
+
+/* Simple pool of workers that run N indexed jobs and wait for all to finish ("parallel for").
+ * The calling thread also does work, so a pool of N threads creates N-1 workers. If the pool
+ * is already running jobs (nested calls, or other thread using it) jobs are done inline instead. */
+typedef struct vgm_pool_t vgm_pool_t;
+
+/* threads: total threads including caller; returns NULL if threads aren't available or < 2 */
+vgm_pool_t* vgm_pool_init(int threads);
+void vgm_pool_free(vgm_pool_t* pool);
+
+/* total threads (including caller), 1 if pool is NULL */
+int vgm_pool_get_threads(vgm_pool_t* pool);
+
+/* calls fn(ctx, index) for index 0..count-1 and returns once all are done (order between indexes isn't defined) */
+void vgm_pool_run(vgm_pool_t* pool, int count, void (*fn)(void* ctx, int index), void* ctx);
+
+#endif
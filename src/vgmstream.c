@@ -13,6 +13,8 @@
 #include "base/render.h"
 #include "base/mixing.h"
 #include "base/mixer.h"
+#include "base/decode_parallel.h"
+#include "base/seek_index.h"
 #include "util/sf_utils.h"
 
 
@@ -251,6 +253,11 @@ void close_vgmstream(VGMSTREAM* vgmstream) {
     render_free(vgmstream);
     vgmstream->layout_data = NULL;
 
+    /* after layouts as sub-VGMSTREAMs may share threads */
+    decode_parallel_free(vgmstream);
+
+    seek_index_free(vgmstream);
+
 
     /* now that the special cases have had their chance, clean up the standard items */
     for (int i = 0; i < vgmstream->channels; i++) {
@@ -276,6 +283,92 @@ void close_vgmstream(VGMSTREAM* vgmstream) {
     free(vgmstream);
 }
 
+bool vgmstream_is_clonable(VGMSTREAM* vgmstream) {
+    /* state that lives elsewhere (codec/layout data, sub-VGMSTREAMs) can't be copied */
+    if (vgmstream->codec_data || vgmstream->layout_data)
+        return false;
+    if (vgmstream->layout_type == layout_segmented || vgmstream->layout_type == layout_layered)
+        return false;
+    return true;
+}
+
+/* Copies a VGMSTREAM as it was at the start of the stream (like after reset_vgmstream), so parsing and setup
+ * aren't needed again. The copy gets its own channel streamfiles (reopened from current ones) and mixer with the
+ * same ops (mixing must be enabled again). Other decoder helpers (threads, seek index) aren't copied. */
+VGMSTREAM* clone_vgmstream(VGMSTREAM* vgmstream) {
+    VGMSTREAM* new_vgmstream = NULL;
+    mixer_t* new_mixer = NULL;
+
+    if (!vgmstream || !vgmstream_is_clonable(vgmstream))
+        return NULL;
+
+    new_vgmstream = allocate_vgmstream(vgmstream->channels, vgmstream->loop_ch != NULL);
+    if (!new_vgmstream) goto fail;
+
+    new_mixer = mixer_clone(vgmstream->mixer);
+    if (!new_mixer) goto fail;
+
+    /* copy start config/state but keep own alloc'ed parts */
+    {
+        VGMSTREAM allocs = *new_vgmstream;
+
+        *new_vgmstream = *((VGMSTREAM*)vgmstream->start_vgmstream);
+        new_vgmstream->ch = allocs.ch;
+        new_vgmstream->loop_ch = allocs.loop_ch;
+        new_vgmstream->start_ch = allocs.start_ch;
+        new_vgmstream->start_vgmstream = allocs.start_vgmstream;
+        new_vgmstream->decode_state = allocs.decode_state;
+        new_vgmstream->tmpbuf = allocs.tmpbuf;
+        new_vgmstream->tmpbuf_size = allocs.tmpbuf_size;
+        new_vgmstream->parallel_data = NULL;
+        new_vgmstream->seek_index = NULL;
+
+        mixer_free(allocs.mixer);
+        new_vgmstream->mixer = new_mixer;
+        new_mixer = NULL;
+    }
+
+    memcpy(new_vgmstream->ch, vgmstream->start_ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    if (vgmstream->loop_ch) {
+        memcpy(new_vgmstream->loop_ch, vgmstream->loop_ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    }
+    for (int i = 0; i < vgmstream->channels; i++) {
+        new_vgmstream->ch[i].streamfile = NULL;
+    }
+
+    /* reopen channel streamfiles (may be shared between channels) */
+    for (int i = 0; i < vgmstream->channels; i++) {
+        STREAMFILE* sf = vgmstream->ch[i].streamfile;
+        if (!sf)
+            continue;
+
+        for (int j = 0; j < i; j++) {
+            if (vgmstream->ch[j].streamfile == sf) {
+                new_vgmstream->ch[i].streamfile = new_vgmstream->ch[j].streamfile;
+                break;
+            }
+        }
+
+        if (!new_vgmstream->ch[i].streamfile) {
+            new_vgmstream->ch[i].streamfile = reopen_streamfile(sf, 0);
+            if (!new_vgmstream->ch[i].streamfile) goto fail;
+        }
+    }
+
+    if (vgmstream->loop_ch) {
+        for (int i = 0; i < vgmstream->channels; i++) {
+            new_vgmstream->loop_ch[i].streamfile = new_vgmstream->ch[i].streamfile;
+        }
+    }
+
+    setup_vgmstream(new_vgmstream);
+    return new_vgmstream;
+fail:
+    mixer_free(new_mixer);
+    close_vgmstream(new_vgmstream);
+    return NULL;
+}
+
 void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sample, int loop_end_sample) {
     if (!vgmstream) return;
 
@@ -300,6 +393,9 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
 
     vgmstream->loop_flag = loop_flag;
 
+    /* saved states depend on loop points */
+    seek_index_clear(vgmstream);
+
     if (loop_flag) {
         vgmstream->loop_start_sample = loop_start_sample;
         vgmstream->loop_end_sample = loop_end_sample;
@@ -243,6 +243,8 @@ typedef struct {
     size_t tmpbuf_size;             /* for all channels (samples = tmpbuf_size / channels / sample_size) */
 
     void* decode_state;             /* for some decoders (TO-DO: to be mover around) */
+    void* parallel_data;            /* for multithreaded decoding (see decode_parallel.c) */
+    void* seek_index;               /* decoder checkpoints for faster seeking (see seek_index.c) */
 } VGMSTREAM;
 
 
@@ -292,6 +294,11 @@ void reset_vgmstream(VGMSTREAM* vgmstream);
 /* close an open vgmstream */
 void close_vgmstream(VGMSTREAM* vgmstream);
 
+/* Copy an open vgmstream at start of stream, for independent playback. Only for simple codecs/layouts,
+ * returns NULL if not possible (vgmstream_is_clonable) */
+VGMSTREAM* clone_vgmstream(VGMSTREAM* vgmstream);
+bool vgmstream_is_clonable(VGMSTREAM* vgmstream);
+
 /* Decode data into sample buffer. Returns < sample_count on stream end */
 int render_vgmstream(sample_t* buffer, int32_t sample_count, VGMSTREAM* vgmstream);
 
@@ -3,7 +3,7 @@
 //typedef VGMSTREAM* (*init_vgmstream_t)(STREAMFILE*);
 
 /* list of metadata parser functions that will recognize files, used on init */
-init_vgmstream_t init_vgmstream_functions[] = {
+static const init_vgmstream_t init_vgmstream_functions[] = {
     init_vgmstream_adx,
     init_vgmstream_brstm,
     init_vgmstream_brwav,
@@ -587,6 +587,26 @@ VGMSTREAM* detect_vgmstream_format(STREAMFILE* sf) {
     return NULL;
 }
 
+/* same as above but for an already known format (from a previous detection), to skip testing others */
+VGMSTREAM* init_vgmstream_from_format_id(STREAMFILE* sf, int format_id) {
+    init_vgmstream_t init_vgmstream_function = get_vgmstream_format_init(format_id);
+    if (!sf || !init_vgmstream_function)
+        return NULL;
+
+    VGMSTREAM* vgmstream = init_vgmstream_function(sf);
+    if (!vgmstream)
+        return NULL;
+
+    vgmstream->format_id = format_id;
+
+    if (!prepare_vgmstream(vgmstream, sf)) {
+        close_vgmstream(vgmstream);
+        return NULL;
+    }
+
+    return vgmstream;
+}
+
 init_vgmstream_t get_vgmstream_format_init(int format_id) {
     // ID is expected to be from 1...N, to distinguish from 0 = not set
     if (format_id <= 0 || format_id > init_vgmstream_count)
@@ -6,6 +6,7 @@
 
 bool prepare_vgmstream(VGMSTREAM* vgmstream, STREAMFILE* sf);
 VGMSTREAM* detect_vgmstream_format(STREAMFILE* sf);
+VGMSTREAM* init_vgmstream_from_format_id(STREAMFILE* sf, int format_id);
 init_vgmstream_t get_vgmstream_format_init(int format_id);
 
 #endif
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* Runs clHCA's dequantize and IMDCT (butterflies + window) stages over random data and dumps the results.
+ * Built twice by CMake: the HCA_DISABLE_SIMD build writes the reference and the default build compares
+ * against it, since the SIMD loops must give the same floats as the scalar ones. The stages are static,
+ * so the decoder is included directly. */
+#include "coding/libs/clhca.c"
+
+#define TEST_FRAMES 64
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t random_u32(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state;
+}
+
+static float random_float(float min, float max) {
+    float r = (float)(random_u32() >> 8) / (float)(1 << 24); /* 0..1 */
+    return min + r * (max - min);
+}
+
+/* results of one frame: dequantized spectra (before the IMDCT overwrites them) then output wave */
+#define FRAME_FLOATS (HCA_SUBFRAMES * HCA_SAMPLES_PER_SUBFRAME * 2)
+
+static void decode_frame(stChannel* ch, float* out) {
+    static const unsigned int coded_counts[] = { 0, 1, 3, 4, 5, 63, 64, 65, 127, 128 };
+    unsigned char bits[0x400];
+    clData br;
+    int i, subframe;
+
+    for (i = 0; i < sizeof(bits); i++) {
+        bits[i] = random_u32() >> 24;
+    }
+    bitreader_init(&br, bits, sizeof(bits));
+
+    ch->coded_count = coded_counts[random_u32() % (sizeof(coded_counts) / sizeof(coded_counts[0]))];
+    for (i = 0; i < HCA_SAMPLES_PER_SUBFRAME; i++) {
+        ch->resolution[i] = random_u32() % 16;
+        ch->gain[i] = random_float(-2.0f, 2.0f) * hcadecoder_scale_conversion_table[random_u32() % 128];
+    }
+
+    for (subframe = 0; subframe < HCA_SUBFRAMES; subframe++) {
+        dequantize_coefficients(ch, &br, subframe);
+        memcpy(out, ch->spectra[subframe], sizeof(ch->spectra[subframe]));
+        out += HCA_SAMPLES_PER_SUBFRAME;
+    }
+
+    for (subframe = 0; subframe < HCA_SUBFRAMES; subframe++) {
+        imdct_transform(ch, subframe);
+    }
+    memcpy(out, ch->wave, sizeof(ch->wave));
+}
+
+int main(int argc, char** argv) {
+    static stChannel ch;
+    static float out[TEST_FRAMES][FRAME_FLOATS];
+    static float ref[TEST_FRAMES][FRAME_FLOATS];
+    FILE* file;
+    int i, errors = 0;
+
+    if (argc != 3 || (strcmp(argv[1], "write") != 0 && strcmp(argv[1], "compare") != 0)) {
+        fprintf(stderr, "usage: %s write|compare (reference file)\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 0; i < TEST_FRAMES; i++) {
+        decode_frame(&ch, out[i]); /* frames chain through imdct_previous */
+    }
+
+    if (strcmp(argv[1], "write") == 0) {
+        file = fopen(argv[2], "wb");
+        if (!file || fwrite(out, sizeof(out), 1, file) != 1) {
+            fprintf(stderr, "clhca: can't write %s\n", argv[2]);
+            return 1;
+        }
+        fclose(file);
+        printf("clhca: reference written\n");
+        return 0;
+    }
+
+    file = fopen(argv[2], "rb");
+    if (!file || fread(ref, sizeof(ref), 1, file) != 1) {
+        fprintf(stderr, "clhca: can't read %s\n", argv[2]);
+        return 1;
+    }
+    fclose(file);
+
+    /* compare bits, as even 1 ULP means the SIMD path changed the operation order */
+    for (i = 0; i < TEST_FRAMES; i++) {
+        int j;
+        for (j = 0; j < FRAME_FLOATS; j++) {
+            if (memcmp(&out[i][j], &ref[i][j], sizeof(float)) == 0)
+                continue;
+            if (errors < 10) {
+                fprintf(stderr, "clhca: frame %i %s[%i]: %.9g vs %.9g\n", i,
+                        j < FRAME_FLOATS / 2 ? "spectra" : "wave", j % (FRAME_FLOATS / 2), out[i][j], ref[i][j]);
+            }
+            errors++;
+        }
+    }
+
+    if (errors) {
+        fprintf(stderr, "clhca: %i errors\n", errors);
+        return 1;
+    }
+#ifdef HCA_SIMD
+    printf("clhca: ok\n");
+#else
+    printf("clhca: ok (no SIMD in this build)\n");
+#endif
+    return 0;
+}
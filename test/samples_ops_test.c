@@ -0,0 +1,100 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util/samples_ops.h"
+
+/* Compares the sample conversion kernels against the scalar loops they replaced in the decoders.
+ * Built twice by CMake (with SIMD and with VGM_DISABLE_SIMD) so both paths are checked. */
+
+#define MAX_CHANNELS 8
+#define MAX_SAMPLES 1024
+
+
+/* old Vorbis (Ogg/custom) pcm_convert_float_to_16, minus Ogg's channel remap */
+static void vorbis_convert_old(int16_t* outbuf, int start_sample, int samples_to_do, float** pcm, int channels) {
+    for (int ch = 0; ch < channels; ch++) {
+        int16_t* ptr = outbuf + ch;
+        float* channel = pcm[ch];
+        for (int s = start_sample; s < samples_to_do; s++) {
+            int val = (int)floor(channel[s] * 32767.0f + 0.5f);
+            if (val > 32767) val = 32767;
+            else if (val < -32768) val = -32768;
+
+            *ptr = val;
+            ptr += channels;
+        }
+    }
+}
+
+static uint32_t rng_state = 0x12345678;
+
+static float random_sample(int mode) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    float r = (float)(rng_state >> 8) / (float)(1 << 24); /* 0..1 */
+
+    switch (mode) {
+        case 0:  return r * 2.4f - 1.2f;                                /* includes clipping */
+        case 1:  return ((int)(r * 65536) - 32768 + 0.5f) / 32767.0f;   /* near half steps */
+        default: return (r - 0.5f) * 1e-4f;                             /* around 0 */
+    }
+}
+
+static int test_vorbis_floor(void) {
+    static float planes[MAX_CHANNELS][MAX_SAMPLES];
+    static int16_t out_old[MAX_CHANNELS * MAX_SAMPLES];
+    static int16_t out_new[MAX_CHANNELS * MAX_SAMPLES];
+    float* pcm[MAX_CHANNELS];
+    float* pcm_skip[MAX_CHANNELS];
+    const int lengths[] = {0, 1, 7, 8, 9, 15, 16, 17, 255, 256, 257, 1000};
+    int errors = 0;
+
+    for (int mode = 0; mode < 3; mode++) {
+        for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+            for (int s = 0; s < MAX_SAMPLES; s++) {
+                planes[ch][s] = random_sample(mode);
+            }
+            pcm[ch] = planes[ch];
+        }
+
+        for (int channels = 1; channels <= MAX_CHANNELS; channels++) {
+            for (int i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+                for (int skip = 0; skip < 3; skip++) {
+                    int samples = lengths[i];
+                    if (skip + samples > MAX_SAMPLES)
+                        continue;
+
+                    memset(out_old, 0x55, sizeof(out_old));
+                    memset(out_new, 0x55, sizeof(out_new));
+
+                    /* old Ogg loop took start_sample, old custom loop used plane pointers */
+                    for (int ch = 0; ch < channels; ch++) {
+                        pcm_skip[ch] = pcm[ch] + skip;
+                    }
+                    vorbis_convert_old(out_old, 0, samples, pcm_skip, channels);
+                    samples_f32p_to_s16_floor(out_new, pcm, channels, skip, samples, 32767.0f);
+
+                    if (memcmp(out_old, out_new, sizeof(out_old)) != 0) {
+                        printf("f32p_to_s16_floor: mismatch mode=%i ch=%i samples=%i skip=%i\n", mode, channels, samples, skip);
+                        errors++;
+                    }
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+int main(void) {
+    int errors = 0;
+
+    errors += test_vorbis_floor();
+
+    if (errors) {
+        printf("samples_ops: %i errors\n", errors);
+        return 1;
+    }
+    printf("samples_ops: ok\n");
+    return 0;
+}
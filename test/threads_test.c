@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "libvgmstream.h"
+#include "libvgmstream_streamfile.h"
+#include "util/threads.h"
+
+/* Decodes generated songs with several configs from many independent libvgmstream_t at once, and checks
+ * output matches a serial decode. Meant to be run with BUILD_TESTS_TSAN too (see libvgmstream.h threading notes).
+ * Files are written to the dir passed as argument. */
+
+#define TEST_THREADS 8
+#define TEST_ROUNDS 2
+#define TEST_SAMPLES (44100 / 2)
+
+static const char* test_files[] = {
+    "pcm.wav",      /* PCM16 */
+    "ima.wav",      /* MS-IMA */
+    "psx.bin",      /* PSX ADPCM with loop, through psx.bin.txth */
+    "seg.txtp",     /* segmented layout of the above */
+};
+#define TEST_FILES (sizeof(test_files) / sizeof(test_files[0]))
+
+enum { CFG_DEFAULT, CFG_SEEK_INDEX, CFG_RESAMPLE, CFG_FLOAT, CFG_DECODE_THREADS, TEST_CONFIGS };
+
+typedef struct {
+    int file;
+    int config;
+    uint32_t hash; /* from serial decode */
+} test_job_t;
+
+#define TEST_JOBS (TEST_FILES * TEST_CONFIGS)
+
+static char base_path[1024];
+static test_job_t jobs[TEST_JOBS];
+static volatile int thread_errors;
+
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t random_u32(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state;
+}
+
+static void put_u16le(uint8_t* buf, int value) {
+    buf[0] = (value >> 0) & 0xFF;
+    buf[1] = (value >> 8) & 0xFF;
+}
+
+static void put_u32le(uint8_t* buf, uint32_t value) {
+    put_u16le(buf + 0x00, value & 0xFFFF);
+    put_u16le(buf + 0x02, value >> 16);
+}
+
+static void get_path(char* dst, size_t dst_size, const char* filename) {
+    snprintf(dst, dst_size, "%s/%s", base_path, filename);
+}
+
+static int write_file(const char* filename, const void* data, size_t size) {
+    char path[1100];
+    FILE* file;
+
+    get_path(path, sizeof(path), filename);
+    file = fopen(path, "wb");
+    if (!file)
+        return 0;
+    if (size && fwrite(data, size, 1, file) != 1) {
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    return 1;
+}
+
+static int write_wav(const char* filename, int codec, int block_align, int bits, int extra_size, const uint8_t* extra, const uint8_t* data, uint32_t data_size) {
+    uint8_t head[0x40] = {0};
+    uint32_t fmt_size = 0x10 + (extra_size ? 0x02 + extra_size : 0);
+    uint32_t head_size = 0x0c + 0x08 + fmt_size + 0x08;
+    uint8_t* buf;
+    int ok;
+
+    memcpy(head + 0x00, "RIFF", 4);
+    put_u32le(head + 0x04, head_size - 0x08 + data_size);
+    memcpy(head + 0x08, "WAVE", 4);
+    memcpy(head + 0x0c, "fmt ", 4);
+    put_u32le(head + 0x10, fmt_size);
+    put_u16le(head + 0x14, codec);
+    put_u16le(head + 0x16, 2);
+    put_u32le(head + 0x18, 44100);
+    put_u32le(head + 0x1c, 44100 * 2 * 2);
+    put_u16le(head + 0x20, block_align);
+    put_u16le(head + 0x22, bits);
+    if (extra_size) {
+        put_u16le(head + 0x24, extra_size);
+        memcpy(head + 0x26, extra, extra_size);
+    }
+    memcpy(head + head_size - 0x08, "data", 4);
+    put_u32le(head + head_size - 0x04, data_size);
+
+    buf = malloc(head_size + data_size);
+    if (!buf)
+        return 0;
+    memcpy(buf, head, head_size);
+    memcpy(buf + head_size, data, data_size);
+    ok = write_file(filename, buf, head_size + data_size);
+    free(buf);
+    return ok;
+}
+
+static int create_files(void) {
+    static uint8_t data[TEST_SAMPLES * 2 * 2];
+    const char* txth =
+        "codec = PSX\n"
+        "channels = 2\n"
+        "sample_rate = 44100\n"
+        "interleave = 0x800\n"
+        "num_samples = data_size\n"
+        "loop_start_sample = 5000\n"
+        "loop_end_sample = num_samples\n";
+    const char* txtp =
+        "pcm.wav #i\n"
+        "ima.wav #i\n"
+        "pcm.wav #i\n";
+    int i;
+
+    /* noisy saw, so all output changes if positions are off */
+    for (i = 0; i < TEST_SAMPLES * 2; i++) {
+        int sample = (i * 37 % 20000) - 10000 + (int)(random_u32() >> 22);
+        put_u16le(data + i * 2, sample);
+    }
+    if (!write_wav("pcm.wav", 0x0001, 0x04, 16, 0, NULL, data, sizeof(data)))
+        return 0;
+
+    /* any data is valid IMA, but frame headers need sane step indexes */
+    for (i = 0; i < sizeof(data) / 4; i++) {
+        data[i] = random_u32() >> 24;
+    }
+    for (i = 0; i < sizeof(data) / 4; i += 0x400) {
+        data[i + 0x02] = data[i + 0x02] % 89;
+        data[i + 0x03] = 0;
+        data[i + 0x06] = data[i + 0x06] % 89;
+        data[i + 0x07] = 0;
+    }
+    {
+        uint8_t extra[0x02];
+        put_u16le(extra, (0x200 - 0x04) * 2 + 1); /* samples per block */
+        if (!write_wav("ima.wav", 0x0011, 0x400, 4, sizeof(extra), extra, data, sizeof(data) / 4))
+            return 0;
+    }
+
+    /* PSX frames: shift/filter header + flags + nibbles */
+    for (i = 0; i < sizeof(data) / 4; i++) {
+        data[i] = random_u32() >> 24;
+    }
+    for (i = 0; i < sizeof(data) / 4; i += 0x10) {
+        data[i + 0x00] = (data[i + 0x00] % 5) << 4 | (8 + data[i + 0x00] % 4);
+        data[i + 0x01] = 0;
+    }
+    if (!write_file("psx.bin", data, sizeof(data) / 4))
+        return 0;
+    if (!write_file("psx.bin.txth", txth, strlen(txth)))
+        return 0;
+
+    if (!write_file("seg.txtp", txtp, strlen(txtp)))
+        return 0;
+    return 1;
+}
+
+
+static void setup_config(libvgmstream_config_t* cfg, int config) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->loop_count = 2;
+    cfg->fade_time = 1;
+
+    switch (config) {
+        case CFG_SEEK_INDEX:        cfg->seek_index = true; break;
+        case CFG_RESAMPLE:          cfg->resample_rate = 48000; break;
+        case CFG_FLOAT:             cfg->force_float = true; break;
+        case CFG_DECODE_THREADS:    cfg->decode_threads = 2; break;
+        default: break;
+    }
+}
+
+static void hash_buf(uint32_t* hash, const void* buf, int bytes) {
+    const uint8_t* data = buf;
+    int i;
+    for (i = 0; i < bytes; i++) {
+        *hash = (*hash ^ data[i]) * 16777619; /* FNV-1a */
+    }
+}
+
+/* opens, decodes everything, seeks back and decodes a bit more, returning a hash of all output (0 on error) */
+static uint32_t decode_job(const test_job_t* job) {
+    libvgmstream_t* lib = NULL;
+    libstreamfile_t* libsf = NULL;
+    libvgmstream_config_t cfg;
+    libvgmstream_options_t opt = {0};
+    char path[1100];
+    uint32_t hash = 2166136261;
+    int i;
+
+    lib = libvgmstream_init();
+    if (!lib) goto fail;
+
+    setup_config(&cfg, job->config);
+    libvgmstream_setup(lib, &cfg);
+
+    get_path(path, sizeof(path), test_files[job->file]);
+    libsf = libstreamfile_open_from_stdio(path);
+    if (!libsf) goto fail;
+
+    opt.libsf = libsf;
+    if (libvgmstream_open_song(lib, &opt) < 0)
+        goto fail;
+    libstreamfile_close(libsf);
+    libsf = NULL;
+
+    while (!lib->decoder->done) {
+        if (libvgmstream_render(lib) < 0)
+            goto fail;
+        hash_buf(&hash, lib->decoder->buf, lib->decoder->buf_bytes);
+    }
+
+    /* decoder->done is only updated on render */
+    libvgmstream_seek(lib, lib->format->play_samples / 3);
+    for (i = 0; i < 4; i++) {
+        if (libvgmstream_render(lib) < 0)
+            goto fail;
+        hash_buf(&hash, lib->decoder->buf, lib->decoder->buf_bytes);
+        if (lib->decoder->done)
+            break;
+    }
+
+    libvgmstream_free(lib);
+    return hash ? hash : 1;
+fail:
+    libstreamfile_close(libsf);
+    libvgmstream_free(lib);
+    return 0;
+}
+
+static void decode_thread(void* arg) {
+    int thread = (int)(intptr_t)arg;
+    int round, i;
+
+    for (round = 0; round < TEST_ROUNDS; round++) {
+        /* each thread starts at a different job so the same file/config is also decoded at once by several threads */
+        for (i = 0; i < TEST_JOBS; i++) {
+            const test_job_t* job = &jobs[(i + thread * 3 + round) % TEST_JOBS];
+            uint32_t hash = decode_job(job);
+
+            if (hash != job->hash) {
+                fprintf(stderr, "threads: %s config %i thread %i: hash %08x vs %08x\n",
+                        test_files[job->file], job->config, thread, hash, job->hash);
+                vgm_global_lock();
+                thread_errors++;
+                vgm_global_unlock();
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    vgm_thread_t* threads[TEST_THREADS] = {0};
+    int i, errors = 0;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s (dir for test files)\n", argv[0]);
+        return 1;
+    }
+    snprintf(base_path, sizeof(base_path), "%s", argv[1]);
+
+    if (!create_files()) {
+        fprintf(stderr, "threads: can't write test files to %s\n", base_path);
+        return 1;
+    }
+
+    for (i = 0; i < TEST_JOBS; i++) {
+        jobs[i].file = i / TEST_CONFIGS;
+        jobs[i].config = i % TEST_CONFIGS;
+        jobs[i].hash = decode_job(&jobs[i]);
+        if (!jobs[i].hash) {
+            fprintf(stderr, "threads: can't decode %s config %i\n", test_files[jobs[i].file], jobs[i].config);
+            errors++;
+        }
+    }
+    if (errors)
+        return 1;
+
+    if (!vgm_threads_available()) {
+        printf("threads: ok (no threads in this build)\n");
+        return 0;
+    }
+
+    for (i = 0; i < TEST_THREADS; i++) {
+        threads[i] = vgm_thread_init(decode_thread, (void*)(intptr_t)i);
+        if (!threads[i]) {
+            fprintf(stderr, "threads: can't create thread %i\n", i);
+            errors++;
+        }
+    }
+    for (i = 0; i < TEST_THREADS; i++) {
+        if (threads[i])
+            vgm_thread_join(threads[i]);
+    }
+    errors += thread_errors;
+
+    if (errors) {
+        fprintf(stderr, "threads: %i errors\n", errors);
+        return 1;
+    }
+    printf("threads: ok\n");
+    return 0;
+}